@@ -16,7 +16,210 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #pragma once
+#include "Attachments.h"
 #include <JuceHeader.h>
+#include <type_traits>
+
+/**
+ * An attachment between a Slider and a parameter, like
+ * AudioProcessorValueTreeState::SliderAttachment, which can be moved to
+ * another parameter with rebind, without recreating neither the attachment
+ * nor the Slider.
+ */
+class RebindableSliderAttachment
+    : private AttachmentBase
+    , private Slider::Listener
+{
+public:
+    RebindableSliderAttachment(AudioProcessorValueTreeState& s,
+        String const& paramID,
+        Slider& slider)
+        : AttachmentBase(s, paramID)
+        , slider(slider)
+    {
+        slider.textFromValueFunction = [this](double value) {
+            return parameter ? parameter->getText(
+                                   parameter->convertTo0to1((float)value), 0)
+                             : String(value);
+        };
+        slider.valueFromTextFunction = [this](String const& text) {
+            return parameter ? (double)parameter->convertFrom0to1(
+                                   parameter->getValueForText(text))
+                             : text.getDoubleValue();
+        };
+        slider.addListener(this);
+        setupRange();
+        sendInitialUpdate();
+    }
+
+    ~RebindableSliderAttachment() override
+    {
+        slider.removeListener(this);
+        slider.textFromValueFunction = nullptr;
+        slider.valueFromTextFunction = nullptr;
+        removeListener();
+    }
+
+    void rebind(String const& newParamID)
+    {
+        if (newParamID == paramID) {
+            return;
+        }
+        rebindListener(newParamID);
+        setupRange();
+        sendInitialUpdate();
+    }
+
+private:
+    void setupRange()
+    {
+        if (!parameter) {
+            return;
+        }
+
+        auto range = parameter->getNormalisableRange();
+
+        // the default value changes with the parameter, even if its range
+        // does not
+        slider.setDoubleClickReturnValue(
+            true, range.convertFrom0to1(parameter->getDefaultValue()));
+
+        // parameters of the same kind, like the coordinates of different knots
+        // of a spline, usually share the range, which is then left as it is
+        bool const isSameRange = isRangeSet &&
+                                 range.start == currentRange.start &&
+                                 range.end == currentRange.end &&
+                                 range.interval == currentRange.interval &&
+                                 range.skew == currentRange.skew &&
+                                 range.symmetricSkew ==
+                                     currentRange.symmetricSkew;
+        if (isSameRange) {
+            return;
+        }
+        currentRange = range;
+        isRangeSet = true;
+
+        // as in juce::SliderParameterAttachment
+        NormalisableRange<double> sliderRange{
+            (double)range.start,
+            (double)range.end,
+            [range](double start, double end, double normalised) mutable {
+                range.start = (float)start;
+                range.end = (float)end;
+                return (double)range.convertFrom0to1((float)normalised);
+            },
+            [range](double start, double end, double value) mutable {
+                range.start = (float)start;
+                range.end = (float)end;
+                return (double)range.convertTo0to1((float)value);
+            },
+            [range](double start, double end, double value) mutable {
+                range.start = (float)start;
+                range.end = (float)end;
+                return (double)range.snapToLegalValue((float)value);
+            }
+        };
+        sliderRange.interval = range.interval;
+        sliderRange.skew = range.skew;
+        sliderRange.symmetricSkew = range.symmetricSkew;
+
+        ScopedValueSetter<bool> svs(ignoreCallbacks, true);
+        slider.setNormalisableRange(sliderRange);
+    }
+
+    void setValue(float newValue) override
+    {
+        ScopedValueSetter<bool> svs(ignoreCallbacks, true);
+        slider.setValue(newValue, sendNotificationSync);
+    }
+
+    void sliderValueChanged(Slider*) override
+    {
+        if (!ignoreCallbacks && parameter) {
+            setNewNormalisedValue(
+                parameter->convertTo0to1((float)slider.getValue()));
+        }
+    }
+
+    void sliderDragStarted(Slider*) override { beginParameterChange(); }
+    void sliderDragEnded(Slider*) override { endParameterChange(); }
+
+    Slider& slider;
+    NormalisableRange<float> currentRange;
+    bool isRangeSet = false;
+    bool ignoreCallbacks = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RebindableSliderAttachment)
+};
+
+/**
+ * An attachment between a Button and a parameter, like
+ * AudioProcessorValueTreeState::ButtonAttachment, which can be moved to
+ * another parameter with rebind, without recreating neither the attachment
+ * nor the Button.
+ */
+class RebindableButtonAttachment
+    : private AttachmentBase
+    , private Button::Listener
+{
+public:
+    RebindableButtonAttachment(AudioProcessorValueTreeState& s,
+        String const& paramID,
+        Button& button)
+        : AttachmentBase(s, paramID)
+        , button(button)
+    {
+        button.addListener(this);
+        sendInitialUpdate();
+    }
+
+    ~RebindableButtonAttachment() override
+    {
+        button.removeListener(this);
+        removeListener();
+    }
+
+    void rebind(String const& newParamID)
+    {
+        if (newParamID == paramID) {
+            return;
+        }
+        rebindListener(newParamID);
+        sendInitialUpdate();
+    }
+
+private:
+    void setValue(float newValue) override
+    {
+        ScopedValueSetter<bool> svs(ignoreCallbacks, true);
+        button.setToggleState(newValue >= 0.5f, sendNotificationSync);
+    }
+
+    void buttonClicked(Button*) override
+    {
+        if (!ignoreCallbacks) {
+            beginParameterChange();
+            setNewNormalisedValue(button.getToggleState() ? 1.f : 0.f);
+            endParameterChange();
+        }
+    }
+
+    Button& button;
+    bool ignoreCallbacks = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RebindableButtonAttachment)
+};
+
+template<class AttachmentClass, class = void>
+struct IsRebindableAttachment : std::false_type
+{};
+
+template<class AttachmentClass>
+struct IsRebindableAttachment<
+    AttachmentClass,
+    std::void_t<decltype(std::declval<AttachmentClass&>().rebind(String()))>>
+    : std::true_type
+{};
 
 template<class ControlClass, class AttachmentClass>
 class Attached
@@ -48,6 +251,13 @@ public:
             return;
         }
 
+        if constexpr (IsRebindableAttachment<AttachmentClass>::value) {
+            if (attachment) {
+                attachment->rebind(paramID);
+                return;
+            }
+        }
+
         attachment = nullptr;
         // it is important to destroy the old attachment before the new
         // one is instantiated!
@@ -66,11 +276,9 @@ private:
     Component* owner;
 };
 
-using AttachedToggle =
-Attached<ToggleButton, AudioProcessorValueTreeState::ButtonAttachment>;
+using AttachedToggle = Attached<ToggleButton, RebindableButtonAttachment>;
 
-class AttachedSlider
-    : public Attached<Slider, AudioProcessorValueTreeState::SliderAttachment>
+class AttachedSlider : public Attached<Slider, RebindableSliderAttachment>
 {
 public:
     AttachedSlider(Component& owner,
@@ -78,7 +286,7 @@ public:
         String const& paramID = "",
         Slider::SliderStyle style =
         Slider::SliderStyle::RotaryHorizontalVerticalDrag)
-        : Attached<Slider, AudioProcessorValueTreeState::SliderAttachment>(
+        : Attached<Slider, RebindableSliderAttachment>(
             owner,
             apvts,
             paramID,
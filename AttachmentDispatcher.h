@@ -0,0 +1,182 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "SharedStateObject.h"
+#include <JuceHeader.h>
+#include <atomic>
+
+/**
+ * The class AttachmentDispatcher delivers to the message thread the updates
+ * of all the attachments to the parameters of an AudioProcessorValueTreeState
+ * that happen on other threads. Instead of each attachment posting its own
+ * message, the attachments are collected in a lock-free list, and a single
+ * message flushes them all. An attachment is in the list at most once, no
+ * matter how many times its parameter changed in the meantime.
+ * During a bulk update, see BulkParameterUpdate, all the updates are held, even
+ * those happening on the message thread, and they are flushed together when
+ * the bulk update ends.
+ * There is one AttachmentDispatcher for each AudioProcessorValueTreeState, see
+ * AttachmentDispatcher::getFor.
+ */
+class AttachmentDispatcher : private AsyncUpdater
+{
+public:
+  class Client
+  {
+  public:
+    virtual ~Client() = default;
+
+    /**
+     * Called on the message thread when the update posted by the client is
+     * flushed.
+     */
+    virtual void handleDispatchedUpdate() = 0;
+
+  private:
+    friend class AttachmentDispatcher;
+    std::atomic<bool> isQueued{ false };
+    Client* next = nullptr;
+  };
+
+  explicit AttachmentDispatcher(AudioProcessorValueTreeState&) {}
+
+  ~AttachmentDispatcher() override { cancelPendingUpdate(); }
+
+  static std::shared_ptr<AttachmentDispatcher> getFor(
+    AudioProcessorValueTreeState& state)
+  {
+    return getSharedObjectForState<AttachmentDispatcher>(state);
+  }
+
+  /**
+   * Schedules an update of the client. Lock-free, it can be called from any
+   * thread.
+   */
+  void post(Client& client)
+  {
+    if (client.isQueued.exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+    push(client);
+    triggerAsyncUpdate();
+  }
+
+  /**
+   * Removes a client from the pending updates. To be called on the message
+   * thread once the client is not going to post any more updates, usually
+   * before destroying it.
+   */
+  void remove(Client& client)
+  {
+    if (!client.isQueued.load(std::memory_order_acquire)) {
+      return;
+    }
+
+    for (Client** it = &flushing; *it != nullptr; it = &(*it)->next) {
+      if (*it == &client) {
+        *it = client.next;
+        break;
+      }
+    }
+
+    auto* queued = queue.exchange(nullptr, std::memory_order_acquire);
+    while (queued) {
+      auto* next = queued->next;
+      if (queued != &client) {
+        push(*queued);
+      }
+      queued = next;
+    }
+
+    client.isQueued.store(false, std::memory_order_release);
+  }
+
+  /**
+   * While a bulk update is in progress the pending updates are held.
+   */
+  void beginBulkUpdate() { ++bulkUpdateDepth; }
+
+  /**
+   * Ends a bulk update, flushing all the updates held during it. If called on
+   * the message thread the updates are flushed immediately.
+   */
+  void endBulkUpdate()
+  {
+    jassert(bulkUpdateDepth > 0);
+    if (--bulkUpdateDepth > 0) {
+      return;
+    }
+    if (MessageManager::existsAndIsCurrentThread()) {
+      cancelPendingUpdate();
+      flush();
+    }
+    else {
+      triggerAsyncUpdate();
+    }
+  }
+
+  bool isInBulkUpdate() const
+  {
+    return bulkUpdateDepth.load(std::memory_order_acquire) > 0;
+  }
+
+  /**
+   * Delivers all the pending updates. To be called on the message thread.
+   */
+  void flush()
+  {
+    // the queue holds the clients from the last to post to the first
+    auto* queued = queue.exchange(nullptr, std::memory_order_acquire);
+    while (queued) {
+      auto* next = queued->next;
+      queued->next = flushing;
+      flushing = queued;
+      queued = next;
+    }
+
+    // a client may be removed while the others are being updated
+    while (auto* client = flushing) {
+      flushing = client->next;
+      client->isQueued.store(false, std::memory_order_release);
+      client->handleDispatchedUpdate();
+    }
+  }
+
+private:
+  void handleAsyncUpdate() override
+  {
+    if (!isInBulkUpdate()) {
+      flush();
+    }
+  }
+
+  void push(Client& client)
+  {
+    auto* head = queue.load(std::memory_order_relaxed);
+    do {
+      client.next = head;
+    } while (!queue.compare_exchange_weak(
+      head, &client, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  std::atomic<Client*> queue{ nullptr };
+  Client* flushing = nullptr;
+  std::atomic<int> bulkUpdateDepth{ 0 };
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AttachmentDispatcher)
+};
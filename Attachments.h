@@ -14,6 +14,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #pragma once
+#include "AttachmentDispatcher.h"
+#include "GestureThrottle.h"
+#include "ParameterRegistry.h"
 #include <JuceHeader.h>
 
 /**
@@ -22,122 +25,176 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
  * difference is that it only uses normalised values for the parameters, so that
  * the attachments can use their own ranges, independent of those of the
  * parameters.
+ * The updates from threads other than the message thread are not delivered
+ * through an AsyncUpdater for each attachment, but through the
+ * AttachmentDispatcher shared by all the attachments to the same
+ * AudioProcessorValueTreeState.
+ * The parameter and its raw value are looked up once, at construction, and
+ * held by the attachment.
+ * The values set during a gesture are sent to the host at most once per
+ * display frame through the GestureThrottle of the
+ * AudioProcessorValueTreeState, and the last one is sent when the gesture
+ * ends.
  */
 struct AttachmentBase
   : public AudioProcessorValueTreeState::Listener
-  , public AsyncUpdater
+  , public AttachmentDispatcher::Client
+  , public GestureThrottle::Client
 {
   AttachmentBase(AudioProcessorValueTreeState& s, const String& p)
     : state(s)
     , paramID(p)
     , lastValue(0)
+    , dispatcher(AttachmentDispatcher::getFor(s))
+    , gestureThrottle(GestureThrottle::getFor(s))
+    , registry(ParameterRegistry::getFor(s))
+    , parameter(registry->getParameter(p))
+    , rawValue(registry->getRawParameterValue(p))
   {
     state.addParameterListener(paramID, this);
   }
 
-  void removeListener() { state.removeParameterListener(paramID, this); }
+  ~AttachmentBase() override
+  {
+    dispatcher->remove(*this);
+    gestureThrottle->flush(*this);
+  }
+
+  void removeListener()
+  {
+    state.removeParameterListener(paramID, this);
+    dispatcher->remove(*this);
+    gestureThrottle->flush(*this);
+  }
+
+  /**
+   * Attaches to another parameter, without sending an update.
+   */
+  void rebindListener(const String& newParamID)
+  {
+    removeListener();
+    paramID = newParamID;
+    parameter = registry->getParameter(paramID);
+    rawValue = registry->getRawParameterValue(paramID);
+    state.addParameterListener(paramID, this);
+  }
 
   void setNewNormalisedValue(float newNormalisedValue)
   {
-    if (auto* p = state.getParameter(paramID)) {
-      if (p->getValue() != newNormalisedValue)
-        p->setValueNotifyingHost(newNormalisedValue);
+    if (gestureDepth > 0) {
+      scheduledValue = newNormalisedValue;
+      gestureThrottle->schedule(*this);
+      return;
+    }
+    if (parameter) {
+      if (parameter->getValue() != newNormalisedValue)
+        parameter->setValueNotifyingHost(newNormalisedValue);
+    }
+  }
+
+  void sendScheduledValue() override
+  {
+    if (parameter) {
+      if (parameter->getValue() != scheduledValue)
+        parameter->setValueNotifyingHost(scheduledValue);
     }
   }
 
   void sendInitialUpdate()
   {
-    if (auto* v = state.getRawParameterValue(paramID))
-      parameterChanged(paramID, *v);
+    if (rawValue)
+      parameterChanged(paramID, *rawValue);
   }
 
   void parameterChanged(const String&, float newValue) override
   {
     lastValue = newValue;
 
-    if (MessageManager::getInstance()->isThisTheMessageThread()) {
-      cancelPendingUpdate();
+    if (MessageManager::getInstance()->isThisTheMessageThread() &&
+        !dispatcher->isInBulkUpdate()) {
       setValue(newValue);
     }
     else {
-      triggerAsyncUpdate();
+      dispatcher->post(*this);
     }
   }
 
   void beginParameterChange()
   {
-    if (auto* p = state.getParameter(paramID)) {
+    if (parameter) {
       if (state.undoManager != nullptr)
         state.undoManager->beginNewTransaction();
 
-      p->beginChangeGesture();
+      parameter->beginChangeGesture();
     }
+    ++gestureDepth;
   }
 
   void endParameterChange()
   {
-    if (AudioProcessorParameter* p = state.getParameter(paramID))
-      p->endChangeGesture();
+    gestureDepth = jmax(0, gestureDepth - 1);
+    gestureThrottle->flush(*this);
+    if (parameter)
+      parameter->endChangeGesture();
   }
 
-  void handleAsyncUpdate() override { setValue(lastValue); }
+  void handleDispatchedUpdate() override { setValue(lastValue); }
 
   virtual void setValue(float) = 0;
 
   AudioProcessorValueTreeState& state;
   String paramID;
-  float lastValue;
+  std::atomic<float> lastValue;
+  std::shared_ptr<AttachmentDispatcher> dispatcher;
+  std::shared_ptr<GestureThrottle> gestureThrottle;
+  std::shared_ptr<ParameterRegistry> registry;
+  RangedAudioParameter* parameter;
+  std::atomic<float>* rawValue;
+  int gestureDepth = 0;
+  float scheduledValue = 0.f;
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AttachmentBase)
 };
 
 /**
- * The class FloatAttachment is almost the same as
+ * The class TypedFloatAttachment is almost the same as
  * juce::AudioProcessorValueTreeState::SliderAttachment, but lets you use your
  * own control instead of a Slider. Actually it does not care what control you
  * use. It just takes a functor to call when the parameter changes.
+ * The functor is stored by value, so a lambda or a function pointer is called
+ * without the type erasure of an std::function. The value is exchanged with an
+ * atomic store, and callbacks are prevented from re-entering with an atomic
+ * counter instead of a lock, so the gui and the host never contend.
  */
-class FloatAttachment : private AttachmentBase
+template<class OnValueChanged>
+class TypedFloatAttachment : private AttachmentBase
 {
 public:
-  FloatAttachment(AudioProcessorValueTreeState& s,
-                  const String& paramID,
-                  std::function<void(void)> onValueChanged,
-                  NormalisableRange<float> editorRange)
+  TypedFloatAttachment(AudioProcessorValueTreeState& s,
+                       const String& paramID,
+                       OnValueChanged onValueChanged,
+                       NormalisableRange<float> editorRange)
     : AttachmentBase(s, paramID)
-    , onValueChanged(onValueChanged)
     , editorRange(editorRange)
-    , ignoreCallbacks(false)
     , value(0.f)
+    , onValueChanged(std::move(onValueChanged))
   {
     sendInitialUpdate();
   }
 
-  template<typename... T>
-  static std::unique_ptr<FloatAttachment> make(T&&... all)
-  {
-    return std::unique_ptr<FloatAttachment>(
-      new FloatAttachment(std::forward<T>(all)...));
-  }
-
-  ~FloatAttachment() override { removeListener(); }
+  ~TypedFloatAttachment() override { removeListener(); }
 
   void setValue(float newValue) override
   {
-    const ScopedLock selfCallbackLock(selfCallbackMutex);
-
-    {
-      ScopedValueSetter<bool> svs(ignoreCallbacks, true);
-      value = newValue;
-      onValueChanged();
-    }
+    ++callbackDepth;
+    value.store(newValue, std::memory_order_release);
+    onValueChanged();
+    --callbackDepth;
   }
 
   void setValueFromGui(float newValue)
   {
-    const ScopedLock selfCallbackLock(selfCallbackMutex);
-
-    if (!ignoreCallbacks) {
+    if (callbackDepth.load(std::memory_order_acquire) == 0) {
       setNewNormalisedValue(
         editorRange.convertTo0to1(editorRange.snapToLegalValue(newValue)));
     }
@@ -146,79 +203,131 @@ public:
   void dragStarted() { beginParameterChange(); }
   void dragEnded() { endParameterChange(); }
 
-  float getValue() const { return value; }
+  float getValue() const { return value.load(std::memory_order_acquire); }
+
+  void rebind(const String& newParamID)
+  {
+    rebindListener(newParamID);
+    sendInitialUpdate();
+  }
 
 private:
   NormalisableRange<float> editorRange;
-  float value;
-  std::function<void(void)> onValueChanged;
-  bool ignoreCallbacks;
-  CriticalSection selfCallbackMutex;
+  std::atomic<float> value;
+  OnValueChanged onValueChanged;
+  std::atomic<int> callbackDepth{ 0 };
 
-  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FloatAttachment)
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TypedFloatAttachment)
 };
 
 /**
- * The class BoolAttachment is almost the same as
+ * The class TypedBoolAttachment is almost the same as
  * juce::AudioProcessorValueTreeState::ButtonAttachment, but lets you use your
  * own control instead of a Button. Actually it does not care what control you
  * use. It just takes a functor to call when the parameter changes.
+ * See TypedFloatAttachment.
  */
-class BoolAttachment : private AttachmentBase
+template<class OnValueChanged>
+class TypedBoolAttachment : private AttachmentBase
 {
 public:
-  BoolAttachment(AudioProcessorValueTreeState& s,
-                 const String& p,
-                 std::function<void(void)> v)
+  TypedBoolAttachment(AudioProcessorValueTreeState& s,
+                      const String& p,
+                      OnValueChanged v)
     : AttachmentBase(s, p)
-    , onValueChanged(v)
-    , ignoreCallbacks(false)
     , value(false)
+    , onValueChanged(std::move(v))
   {
     sendInitialUpdate();
   }
 
-  template<typename... T>
-  static std::unique_ptr<BoolAttachment> make(T&&... all)
-  {
-    return std::unique_ptr<BoolAttachment>(
-      new BoolAttachment(std::forward<T>(all)...));
-  }
-
-  ~BoolAttachment() override { removeListener(); }
+  ~TypedBoolAttachment() override { removeListener(); }
 
   void setValue(float newValue) override
   {
-    const ScopedLock selfCallbackLock(selfCallbackMutex);
-
-    {
-      ScopedValueSetter<bool> svs(ignoreCallbacks, true);
-      value = newValue >= 0.5f;
-      onValueChanged();
-    }
+    ++callbackDepth;
+    value.store(newValue >= 0.5f, std::memory_order_release);
+    onValueChanged();
+    --callbackDepth;
   }
 
   void setValueFromGui(bool newValue)
   {
-    const ScopedLock selfCallbackLock(selfCallbackMutex);
-
-    if (!ignoreCallbacks) {
+    if (callbackDepth.load(std::memory_order_acquire) == 0) {
       beginParameterChange();
-      value = newValue;
-      setNewNormalisedValue(value ? 1.0f : 0.0f);
+      value.store(newValue, std::memory_order_release);
+      setNewNormalisedValue(newValue ? 1.0f : 0.0f);
       endParameterChange();
     }
   }
 
-  void invertValueFromGui() { setValueFromGui(!value); }
+  void invertValueFromGui() { setValueFromGui(!getValue()); }
 
-  bool getValue() const { return value; }
+  void rebind(const String& newParamID)
+  {
+    rebindListener(newParamID);
+    sendInitialUpdate();
+  }
+
+  bool getValue() const { return value.load(std::memory_order_acquire); }
 
 private:
-  bool value;
-  std::function<void(void)> onValueChanged;
-  bool ignoreCallbacks;
-  CriticalSection selfCallbackMutex;
+  std::atomic<bool> value;
+  OnValueChanged onValueChanged;
+  std::atomic<int> callbackDepth{ 0 };
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TypedBoolAttachment)
+};
+
+template<class OnValueChanged>
+std::unique_ptr<TypedFloatAttachment<OnValueChanged>>
+makeFloatAttachment(AudioProcessorValueTreeState& s,
+                    const String& paramID,
+                    OnValueChanged onValueChanged,
+                    NormalisableRange<float> editorRange)
+{
+  return std::make_unique<TypedFloatAttachment<OnValueChanged>>(
+    s, paramID, std::move(onValueChanged), editorRange);
+}
+
+template<class OnValueChanged>
+std::unique_ptr<TypedBoolAttachment<OnValueChanged>>
+makeBoolAttachment(AudioProcessorValueTreeState& s,
+                   const String& paramID,
+                   OnValueChanged onValueChanged)
+{
+  return std::make_unique<TypedBoolAttachment<OnValueChanged>>(
+    s, paramID, std::move(onValueChanged));
+}
 
-  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BoolAttachment)
+/**
+ * A TypedFloatAttachment that calls an std::function.
+ */
+class FloatAttachment : public TypedFloatAttachment<std::function<void(void)>>
+{
+public:
+  using TypedFloatAttachment::TypedFloatAttachment;
+
+  template<typename... T>
+  static std::unique_ptr<FloatAttachment> make(T&&... all)
+  {
+    return std::unique_ptr<FloatAttachment>(
+      new FloatAttachment(std::forward<T>(all)...));
+  }
+};
+
+/**
+ * A TypedBoolAttachment that calls an std::function.
+ */
+class BoolAttachment : public TypedBoolAttachment<std::function<void(void)>>
+{
+public:
+  using TypedBoolAttachment::TypedBoolAttachment;
+
+  template<typename... T>
+  static std::unique_ptr<BoolAttachment> make(T&&... all)
+  {
+    return std::unique_ptr<BoolAttachment>(
+      new BoolAttachment(std::forward<T>(all)...));
+  }
 };
@@ -0,0 +1,170 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "GainComputer.h"
+#include "LoudnessMeter.h"
+#include <JuceHeader.h>
+#include <ostream>
+
+/**
+ * Benchmarks for the audio thread code of this library. Each function writes
+ * its results to an std::ostream, one JSON object per line, so that they can
+ * be collected and compared across versions. They can be called from a
+ * console application or from the test runner of a plugin.
+ */
+
+namespace benchmarks {
+
+/**
+ * Returns the average time, in nanoseconds, of a call to the functor.
+ */
+template<class Functor>
+double
+measureNanoseconds(Functor&& functor, int numRepetitions)
+{
+  functor(); // warm up
+  auto const start = Time::getHighResolutionTicks();
+  for (int i = 0; i < numRepetitions; ++i) {
+    functor();
+  }
+  auto const end = Time::getHighResolutionTicks();
+  return 1.0e9 * Time::highResolutionTicksToSeconds(end - start) /
+         (double)numRepetitions;
+}
+
+inline AudioBuffer<float>
+makeNoise(int numChannels, int numSamples)
+{
+  AudioBuffer<float> buffer(numChannels, numSamples);
+  Random random(1);
+  for (int c = 0; c < numChannels; ++c) {
+    for (int i = 0; i < numSamples; ++i) {
+      buffer.setSample(c, i, random.nextFloat() * 2.f - 1.f);
+    }
+  }
+  return buffer;
+}
+
+} // namespace benchmarks
+
+/**
+ * Benchmarks the LoudnessMeter and the TruePeakDetector at 48kHz and 96kHz,
+ * reporting the cost per channel per second of audio.
+ */
+inline void
+benchmarkMeterKernels(std::ostream& output, int blockSize = 512)
+{
+  for (double sampleRate : { 48000.0, 96000.0 }) {
+    int const numSamples = (int)sampleRate;
+    auto noise = benchmarks::makeNoise(2, numSamples);
+
+    auto const report = [&](char const* kernel, double nanoseconds) {
+      output << "{\"benchmark\":\"meter\",\"kernel\":\"" << kernel
+             << "\",\"sampleRate\":" << sampleRate
+             << ",\"blockSize\":" << blockSize
+             << ",\"nsPerSample\":" << nanoseconds / numSamples
+             << ",\"usPerSecondOfAudio\":" << 1.0e-3 * nanoseconds << "}\n";
+    };
+
+    TruePeakDetector truePeakDetector;
+    double const truePeakTime = benchmarks::measureNanoseconds(
+      [&] {
+        for (int i = 0; i < numSamples; i += blockSize) {
+          truePeakDetector.processBlock(noise.getReadPointer(0, i),
+                                        jmin(blockSize, numSamples - i));
+        }
+      },
+      10);
+    report("truePeak", truePeakTime);
+
+    LoudnessMeter meter(sampleRate);
+    double const meterTime = benchmarks::measureNanoseconds(
+      [&] {
+        for (int i = 0; i < numSamples; i += blockSize) {
+          float const* input[] = { noise.getReadPointer(0, i),
+                                   noise.getReadPointer(1, i) };
+          meter.processBlock(input, jmin(blockSize, numSamples - i));
+        }
+      },
+      10);
+    // the meter processes both channels
+    report("loudnessAndTruePeak", 0.5 * meterTime);
+  }
+}
+
+/**
+ * Benchmarks the fused GainComputer::processBlock against the two pass
+ * GainComputer::processBlockTwoPass, with a 5 knots transfer curve, reporting
+ * the cost per sample of both channels. The follower must be the one the
+ * processor runs, an adsp::GammaEnv configured from its GammaEnvParameters, as
+ * described in GainComputer. Each kernel runs on its own copy of it.
+ */
+template<class Follower>
+void
+benchmarkGainComputer(std::ostream& output, Follower const& follower)
+{
+  double const sampleRate = 48000.0;
+  int const numSamples = (int)sampleRate;
+  auto sidechain = benchmarks::makeNoise(2, numSamples);
+  AudioBuffer<float> gain(2, numSamples);
+
+  AudioProcessorValueTreeState::ParameterLayout layout;
+  SplineParameters curve("Curve",
+                         layout,
+                         5,
+                         { -96.f, 0.f, 0.1f },
+                         { -96.f, 0.f, 0.1f },
+                         { 0.f, 10.f, 0.01f });
+
+  for (int blockSize : { 64, 512, 4096 }) {
+    GainComputer<8> gainComputer;
+    gainComputer.prepare(blockSize);
+    gainComputer.updateCurve(curve);
+
+    auto const run = [&](bool isFused) {
+      Follower blockFollower = follower;
+      return benchmarks::measureNanoseconds(
+        [&] {
+          for (int i = 0; i < numSamples; i += blockSize) {
+            float const* input[] = { sidechain.getReadPointer(0, i),
+                                     sidechain.getReadPointer(1, i) };
+            float* gains[] = { gain.getWritePointer(0, i),
+                               gain.getWritePointer(1, i) };
+            int const n = jmin(blockSize, numSamples - i);
+            if (isFused) {
+              gainComputer.processBlock(blockFollower, input, gains, n);
+            }
+            else {
+              gainComputer.processBlockTwoPass(blockFollower, input, gains, n);
+            }
+          }
+        },
+        10);
+    };
+
+    for (bool isFused : { true, false }) {
+      double const nanoseconds = run(isFused);
+      output << "{\"benchmark\":\"gainComputer\",\"kernel\":\""
+             << (isFused ? "fused" : "twoPass")
+             << "\",\"sampleRate\":" << sampleRate
+             << ",\"blockSize\":" << blockSize
+             << ",\"nsPerSample\":" << nanoseconds / numSamples
+             << ",\"usPerSecondOfAudio\":" << 1.0e-3 * nanoseconds << "}\n";
+    }
+  }
+}
@@ -0,0 +1,78 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * Bit manipulation helpers for the 64 bit masks used by this library.
+ */
+
+namespace bitMask {
+
+/**
+ * Returns the index of the lowest set bit of a non-zero mask.
+ */
+inline int
+lowestSetBit(uint64_t mask)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, mask);
+  return (int)index;
+#else
+  return __builtin_ctzll(mask);
+#endif
+}
+
+/**
+ * Returns the number of set bits of a mask.
+ */
+inline int
+countSetBits(uint64_t mask)
+{
+#if defined(_MSC_VER)
+  return (int)__popcnt64(mask);
+#else
+  return __builtin_popcountll(mask);
+#endif
+}
+
+/**
+ * Calls a functor with the index of each set bit of a mask, from the lowest.
+ */
+template<class Functor>
+void
+forEachSetBit(uint64_t mask, Functor&& functor)
+{
+  while (mask != 0) {
+    functor(lowestSetBit(mask));
+    mask &= mask - 1;
+  }
+}
+
+inline uint64_t
+bit(int index)
+{
+  return uint64_t(1) << index;
+}
+
+} // namespace bitMask
@@ -0,0 +1,75 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "AttachmentDispatcher.h"
+#include "ParameterRegistry.h"
+#include <JuceHeader.h>
+
+/**
+ * While an instance of BulkParameterUpdate exists, the attachments of this
+ * library to the parameters of an AudioProcessorValueTreeState, and the
+ * components built on them, do not react to changes of the parameters. When
+ * it is destroyed they are all updated in a single pass, each of them once, no
+ * matter how many times its parameter changed. Use it to load presets or to
+ * change many parameters at once.
+ */
+class BulkParameterUpdate
+{
+public:
+  explicit BulkParameterUpdate(AudioProcessorValueTreeState& state)
+    : dispatcher(AttachmentDispatcher::getFor(state))
+  {
+    dispatcher->beginBulkUpdate();
+  }
+
+  ~BulkParameterUpdate() { dispatcher->endBulkUpdate(); }
+
+private:
+  std::shared_ptr<AttachmentDispatcher> dispatcher;
+
+  JUCE_DECLARE_NON_COPYABLE(BulkParameterUpdate)
+};
+
+/**
+ * Replaces the state of an AudioProcessorValueTreeState inside a
+ * BulkParameterUpdate.
+ */
+inline void
+applyStateInBulk(AudioProcessorValueTreeState& state, ValueTree const& newState)
+{
+  BulkParameterUpdate bulkUpdate(state);
+  state.replaceState(newState);
+}
+
+/**
+ * Sets the values of many parameters inside a BulkParameterUpdate. The values
+ * are not normalised. The parameters are looked up in the ParameterRegistry
+ * of the state.
+ */
+inline void
+setParametersInBulk(AudioProcessorValueTreeState& state,
+                    std::vector<std::pair<String, float>> const& values)
+{
+  auto const registry = ParameterRegistry::getFor(state);
+  BulkParameterUpdate bulkUpdate(state);
+  for (auto& [paramID, value] : values) {
+    if (auto* parameter = registry->getParameter(paramID)) {
+      parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+  }
+}
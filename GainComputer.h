@@ -0,0 +1,148 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "SplineParameters.h"
+#include "adsp/Spline.hpp"
+#include "avec/Avec.hpp"
+#include <JuceHeader.h>
+
+/**
+ * The gain computer of a compressor: an envelope follower on the sidechain,
+ * followed by a transfer curve in decibels, given by a spline whose knots come
+ * from SplineParameters. It outputs the gain to apply to each channel.
+ * The envelope follower is the one of the processor, an adsp::GammaEnv
+ * configured from its GammaEnvParameters, which keeps its own state. It is
+ * passed to processBlock and processBlockTwoPass as any object that can be
+ * called as
+ * @code
+ * // writes the envelope of samples [start, start + numSamples) of the
+ * // sidechain into the first numSamples elements of envelope, one channel per
+ * // lane
+ * follower(float const* const* sidechain,
+ *          int start,
+ *          int numSamples,
+ *          VecBuffer<Vec2d>& envelope);
+ * @endcode
+ * It always works on two channels, one per lane of a Vec2d: the sidechain and
+ * the gain must both have two channels, even for a mono processor, which can
+ * pass the same pointer twice as sidechain and ignore the second gain channel.
+ * processBlock runs the whole chain over chunks of chunkSize samples, which
+ * stay in the cache from the envelope to the gain, instead of writing the
+ * envelope of the whole block to memory and reading it back for the spline.
+ * processBlockTwoPass is the two pass version, kept as a reference for the
+ * benchmarks, see benchmarkGainComputer.
+ */
+template<int maxNumKnots>
+class GainComputer
+{
+public:
+  using Spline = adsp::Spline<Vec2d, maxNumKnots>;
+
+  static constexpr int chunkSize = 32;
+
+  GainComputer()
+    : spline(avec::Aligned<Spline>::make())
+  {}
+
+  /**
+   * Allocates the buffers used by processBlockTwoPass. Not to be called by the
+   * audio thread.
+   */
+  void prepare(int maxBlockSize)
+  {
+    blockLevels.setNumSamples(maxBlockSize);
+    blockCurve.setNumSamples(maxBlockSize);
+    preparedSize = maxBlockSize;
+  }
+
+  /**
+   * Reads the knots of the transfer curve. To be called by the audio thread at
+   * the start of each block.
+   */
+  void updateCurve(SplineParameters& parameters)
+  {
+    numKnots = parameters.updateSpline(*spline);
+  }
+
+  /**
+   * Computes the linear gain of each of the two channels from the sidechain.
+   */
+  template<class Follower>
+  void processBlock(Follower& follower,
+                    float const* const* sidechain,
+                    float* const* gain,
+                    int numSamples)
+  {
+    for (int start = 0; start < numSamples; start += chunkSize) {
+      int const n = jmin(chunkSize, numSamples - start);
+      chunkLevels.setNumSamples(n);
+      chunkCurve.setNumSamples(n);
+      follower(sidechain, start, n, chunkLevels);
+      applyCurve(chunkLevels, chunkCurve, gain, start, n);
+    }
+  }
+
+  /**
+   * Same as processBlock, but running each stage over the whole block, which
+   * must not be longer than the size passed to prepare.
+   */
+  template<class Follower>
+  void processBlockTwoPass(Follower& follower,
+                           float const* const* sidechain,
+                           float* const* gain,
+                           int numSamples)
+  {
+    jassert(numSamples <= preparedSize);
+    blockLevels.setNumSamples(numSamples);
+    blockCurve.setNumSamples(numSamples);
+    follower(sidechain, 0, numSamples, blockLevels);
+    applyCurve(blockLevels, blockCurve, gain, 0, numSamples);
+  }
+
+private:
+  // levels holds the envelope, and it is converted to decibels in place
+  void applyCurve(VecBuffer<Vec2d>& levels,
+                  VecBuffer<Vec2d>& curve,
+                  float* const* gain,
+                  int start,
+                  int numSamples)
+  {
+    // 20 * log10(x) = decibelsPerLog * log(x)
+    double const decibelsPerLog = 20.0 / std::log(10.0);
+    for (int i = 0; i < numSamples; ++i) {
+      levels[i] = decibelsPerLog * log(max(Vec2d(levels[i]), 1.0e-10));
+    }
+    splineDispatcher.processBlock(*spline, levels, curve, numKnots);
+    for (int i = 0; i < numSamples; ++i) {
+      Vec2d const gainInDecibels = Vec2d(curve[i]) - Vec2d(levels[i]);
+      Vec2d const linearGain = exp(gainInDecibels * (1.0 / decibelsPerLog));
+      gain[0][start + i] = (float)linearGain.extract(0);
+      gain[1][start + i] = (float)linearGain.extract(1);
+    }
+  }
+
+  aligned_ptr<Spline> spline;
+  adsp::SplineDispatcher<Vec2d, maxNumKnots> splineDispatcher;
+  int numKnots = 0;
+
+  VecBuffer<Vec2d> chunkLevels{ chunkSize };
+  VecBuffer<Vec2d> chunkCurve{ chunkSize };
+  VecBuffer<Vec2d> blockLevels{ 1 };
+  VecBuffer<Vec2d> blockCurve{ 1 };
+  int preparedSize = 0;
+};
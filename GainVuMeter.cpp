@@ -17,23 +17,43 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "GainVuMeter.h"
 
-GainVuMeter::GainVuMeter(std::array<std::atomic<float>*, 2> source,
+GainVuMeter::GainVuMeter(MeterBus& bus,
+                         std::array<int, 2> busIndices,
                          float range,
                          std::function<float(float)> scaling,
                          Colour lowColour,
                          Colour highColour,
                          Colour backgroundColour)
-  : source(source)
+  : bus(bus)
+  , busIndices(busIndices)
   , range(range)
   , scaling(scaling)
   , lowColour(lowColour)
   , highColour(highColour)
   , backgroundColour(backgroundColour)
 {
+  for (int c = 0; c < 2; ++c) {
+    bars[c] = std::make_unique<ChannelBar>(*this, c);
+    addAndMakeVisible(*bars[c]);
+  }
   setSize(16, 128);
   startTimer(50.f);
 }
 
+GainVuMeter::ChannelBar::ChannelBar(GainVuMeter& meter, int channel)
+  : meter(meter)
+  , channel(channel)
+{
+  setOpaque(true);
+  setInterceptsMouseClicks(false, false);
+}
+
+void
+GainVuMeter::ChannelBar::paint(Graphics& g)
+{
+  meter.paintChannel(g, channel, (float)getWidth());
+}
+
 void
 GainVuMeter::paint(Graphics& g)
 {
@@ -86,95 +106,186 @@ GainVuMeter::paint(Graphics& g)
   drawReferenceLine(12);
   drawReferenceLine(24);
   drawReferenceLine(36);
+}
+
+void
+GainVuMeter::paintOverChildren(Graphics& g)
+{
+  float const dx = getWidth() / 3.f;
+
+  g.setColour(lineColour);
+  g.drawRect(getLocalBounds());
+  g.drawRect(dx, 0.f, dx, (float)getHeight());
+}
+
+void
+GainVuMeter::paintChannel(Graphics& g, int c, float dx)
+{
+  float const halfHeight = getHeight() * 0.5f;
+
+  g.setFont(fontSize);
 
   // background
 
+  g.fillAll(Colours::black);
+
+  // meter
+
+  float const db = value[c];
+
+  float const yNorm = jlimit(-1.f, 1.f, db / range);
+  float const y = std::copysign(scaling(std::abs(yNorm)), yNorm);
+
+  float const left = 0.f;
+  if (y > 0.f) {
+    g.setGradientFill(topGradient);
+    g.fillRect(left, halfHeight * (1.f - y), dx, y * halfHeight);
+  }
+  else {
+    g.setGradientFill(bottomGradient);
+    g.fillRect(left, halfHeight, dx, -halfHeight * y);
+  }
+
+  constexpr float minMaxEdge = 4.f;
+
+  g.setGradientFill(topGradient);
+  float const maxY = scaling(jmin(1.f, maxValue[c] / range));
+  float const maxYCoord = halfHeight * (1.f - maxY);
+
+  if (maxYCoord < minMaxEdge) {
+    g.fillRect(left, 0.f, dx, minMaxEdge);
+  }
+  else {
+    g.drawLine(left, maxYCoord, left + dx, maxYCoord, 1);
+  }
+
+  if (maxYCoord >= 24 && maxYCoord < halfHeight - 20) {
+    g.drawText(String(maxValue[c], 1),
+               Rectangle((int)left, (int)maxYCoord - 24, (int)dx, 20),
+               Justification::centred);
+  }
+
+  g.setGradientFill(bottomGradient);
+  float const minY = scaling(std::abs(jmax(-1.f, minValue[c] / range)));
+  float const minYCoord = halfHeight * (1.f + minY);
+
+  float const minRectangleStart = (float)getHeight() - minMaxEdge;
+  if (minYCoord > minRectangleStart) {
+    g.fillRect(left, minRectangleStart, dx, minMaxEdge);
+  }
+  else {
+    g.drawLine(left, minYCoord, left + dx, minYCoord, 1);
+  }
+
+  if (minYCoord + 24 < getHeight() && minYCoord > halfHeight + 20) {
+    g.drawText(String(minValue[c], 1),
+               Rectangle((int)left, (int)minYCoord + 4, (int)dx, 20),
+               Justification::centred);
+  }
+
   g.setColour(Colours::black);
-  g.fillRect(0.f, 0.f, dx, (float)getHeight());
-  g.fillRect(2.f * dx, 0.f, dx, (float)getHeight());
 
-  // meters
+  if (db >= 0.1f) {
+    g.drawText(String(db, 1),
+               Rectangle((int)left, (int)halfHeight - 18, (int)dx, 20),
+               Justification::centred);
+  }
+  else if (db <= -0.1f) {
+    g.drawText(String(db, 1),
+               Rectangle((int)left, (int)halfHeight + 2, (int)dx, 20),
+               Justification::centred);
+  }
+}
+
+void
+GainVuMeter::timerCallback()
+{
+  if (bus.getSequence() == snapshot.sequence) {
+    return;
+  }
 
-  g.setColour(Colours::darkgrey);
+  bus.read(snapshot);
 
   for (int c = 0; c < 2; ++c) {
-    float const db = jlimit(-range, range, source[c]->load());
-
+    float const db = jlimit(-range, range, snapshot[busIndices[c]]);
+    value[c] = db;
     minValue[c] = jmin(db, minValue[c]);
     maxValue[c] = jmax(db, maxValue[c]);
+    repaintChanges(c, computeGeometry(c));
+  }
+}
 
-    float const yNorm = jlimit(-1.f, 1.f, db / range);
-    float const y = std::copysign(scaling(std::abs(yNorm)), yNorm);
-
-    float left = c == 0 ? 0.f : 2.f * dx;
-    if (y > 0.f) {
-      g.setGradientFill(topGradient);
-      g.fillRect(left, halfHeight * (1.f - y), dx, y * halfHeight);
-    }
-    else {
-      g.setGradientFill(bottomGradient);
-      g.fillRect(left, halfHeight, dx, -halfHeight * y);
-    }
+GainVuMeter::BarGeometry
+GainVuMeter::computeGeometry(int c)
+{
+  float const halfHeight = getHeight() * 0.5f;
 
-    constexpr float minMaxEdge = 4.f;
+  float const yNorm = jlimit(-1.f, 1.f, value[c] / range);
+  float const y = std::copysign(scaling(std::abs(yNorm)), yNorm);
+
+  float const maxY = scaling(jmin(1.f, maxValue[c] / range));
+  float const minY = scaling(std::abs(jmax(-1.f, minValue[c] / range)));
+
+  BarGeometry geometry;
+  geometry.barTop = roundToInt(halfHeight * (1.f - jmax(0.f, y)));
+  geometry.barBottom = roundToInt(halfHeight * (1.f - jmin(0.f, y)));
+  geometry.maxY = roundToInt(halfHeight * (1.f - maxY));
+  geometry.minY = roundToInt(halfHeight * (1.f + minY));
+  geometry.valueText = roundToInt(10.f * value[c]);
+  geometry.maxText = roundToInt(10.f * maxValue[c]);
+  geometry.minText = roundToInt(10.f * minValue[c]);
+  return geometry;
+}
 
-    g.setGradientFill(topGradient);
-    float const maxY = scaling(jmin(1.f, maxValue[c] / range));
-    float const maxYCoord = halfHeight * (1.f - maxY);
+void
+GainVuMeter::repaintChanges(int c, BarGeometry const& geometry)
+{
+  auto& painted = paintedGeometry[c];
+  auto& bar = *bars[c];
 
-    if (maxYCoord < minMaxEdge) {
-      g.fillRect(left, 0.f, dx, minMaxEdge);
-    }
-    else {
-      g.drawLine(left, maxYCoord, left + dx, maxYCoord, 1);
-    }
+  // a couple of pixels of margin for antialiasing
+  auto const repaintRows = [&](int top, int bottom) {
+    bar.repaint(0, top - 2, bar.getWidth(), bottom - top + 4);
+  };
 
-    if (maxYCoord >= 24 && maxYCoord < halfHeight - 20) {
-      g.drawText(String(maxValue[c], 1),
-                 Rectangle((int)left, (int)maxYCoord - 24, (int)dx, 20),
-                 Justification::centred);
-    }
+  int const halfHeight = getHeight() / 2;
 
-    g.setGradientFill(bottomGradient);
-    float const minY = scaling(std::abs(jmax(-1.f, minValue[c] / range)));
-    float const minYCoord = halfHeight * (1.f + minY);
+  bool const barChanged = painted.barTop != geometry.barTop ||
+                          painted.barBottom != geometry.barBottom;
 
-    float const minRectangleStart = (float)getHeight() - minMaxEdge;
-    if (minYCoord > minRectangleStart) {
-      g.fillRect(left, minRectangleStart, dx, minMaxEdge);
-    }
-    else {
-      g.drawLine(left, minYCoord, left + dx, minYCoord, 1);
-    }
+  if (barChanged) {
+    repaintRows(jmin(painted.barTop, geometry.barTop),
+                jmax(painted.barBottom, geometry.barBottom));
+  }
 
-    if (minYCoord + 24 < getHeight() && minYCoord > halfHeight + 20) {
-      g.drawText(String(minValue[c], 1),
-                 Rectangle((int)left, (int)minYCoord + 4, (int)dx, 20),
-                 Justification::centred);
-    }
+  if (barChanged || painted.valueText != geometry.valueText) {
+    // the label of the value, drawn over the bar
+    repaintRows(halfHeight - 18, halfHeight + 22);
+  }
 
-    g.setColour(Colours::black);
+  if (painted.maxY != geometry.maxY || painted.maxText != geometry.maxText) {
+    // the line and the label of the maximum, and the edge at the top
+    repaintRows(jmin(painted.maxY, geometry.maxY) - 24,
+                jmax(painted.maxY, geometry.maxY));
+  }
 
-    if (db >= 0.1f) {
-      g.drawText(String(db, 1),
-                 Rectangle((int)left, (int)halfHeight - 18, (int)dx, 20),
-                 Justification::centred);
-    }
-    else if (db <= -0.1f) {
-      g.drawText(String(db, 1),
-                 Rectangle((int)left, (int)halfHeight + 2, (int)dx, 20),
-                 Justification::centred);
-    }
+  if (painted.minY != geometry.minY || painted.minText != geometry.minText) {
+    // the line and the label of the minimum, and the edge at the bottom
+    repaintRows(jmin(painted.minY, geometry.minY),
+                jmax(painted.minY, geometry.minY) + 24);
   }
 
-  g.setColour(lineColour);
-  g.drawRect(getLocalBounds());
-  g.drawRect(dx, 0.f, dx, (float)getHeight());
+  painted = geometry;
 }
 
 void
 GainVuMeter::resized()
 {
+  int const width = getWidth() / 3;
+  int const rightBarLeft = roundToInt(2.f * getWidth() / 3.f);
+  bars[0]->setBounds(0, 0, width, getHeight());
+  bars[1]->setBounds(rightBarLeft, 0, getWidth() - rightBarLeft, getHeight());
+
   updateGradients();
   reset();
 }
@@ -205,10 +316,18 @@ GainVuMeter::updateGradients()
     lowColour, 0.f, getHeight() * 0.5f, highColour, 0.f, getHeight(), false);
 
   bottomGradient.addColour(0.5, Colours::yellow);
+
+  for (auto& bar : bars) {
+    bar->repaint();
+  }
 }
 
 void
 GainVuMeter::reset()
 {
   minValue[0] = minValue[1] = maxValue[0] = maxValue[1] = 0.f;
+  for (int c = 0; c < 2; ++c) {
+    paintedGeometry[c] = computeGeometry(c);
+    bars[c]->repaint();
+  }
 }
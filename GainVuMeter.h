@@ -16,12 +16,17 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #pragma once
+#include "MeterBus.h"
 #include <JuceHeader.h>
 #include <array>
 
 /**
  * A simple Component implementing a gain VU meter, useful to show gain
- * reduction in dynamic processors.
+ * reduction in dynamic processors. It shows two values, in dB, read from a
+ * MeterBus.
+ * The bars of the two channels are opaque child components, and on each frame
+ * only the parts of them that changed are repainted, so neither the scale nor
+ * the parent components are redrawn when the values move.
  */
 
 class GainVuMeter
@@ -30,7 +35,8 @@ class GainVuMeter
 {
 public:
   GainVuMeter(
-    std::array<std::atomic<float>*, 2> source,
+    MeterBus& bus,
+    std::array<int, 2> busIndices,
     float range = 36.f,
     std::function<float(float)> scaling = [](float x) { return std::sqrt(x); },
     Colour lowColour = Colours::green,
@@ -38,6 +44,7 @@ public:
     Colour backgroundColour = Colours::black);
 
   void paint(Graphics& g) override;
+  void paintOverChildren(Graphics& g) override;
   void resized() override;
   void mouseDown(MouseEvent const& event) override;
 
@@ -54,20 +61,59 @@ public:
 
   std::function<float(float)> scaling;
 
-  std::array<std::atomic<float>*, 2> source;
+  MeterBus& bus;
+
+  std::array<int, 2> busIndices;
 
 private:
-  void timerCallback() override { repaint(); }
+  class ChannelBar : public Component
+  {
+  public:
+    ChannelBar(GainVuMeter& meter, int channel);
+
+    void paint(Graphics& g) override;
+
+  private:
+    GainVuMeter& meter;
+    int channel;
+  };
+
+  // what is drawn by a ChannelBar, in pixels and tenths of dB
+  struct BarGeometry
+  {
+    int barTop = 0;
+    int barBottom = 0;
+    int maxY = 0;
+    int minY = 0;
+    int valueText = 0;
+    int maxText = 0;
+    int minText = 0;
+  };
+
+  void timerCallback() override;
+
+  void paintChannel(Graphics& g, int channel, float width);
+
+  BarGeometry computeGeometry(int channel);
+
+  void repaintChanges(int channel, BarGeometry const& newGeometry);
 
   void updateGradients();
 
   void reset();
 
+  std::array<std::unique_ptr<ChannelBar>, 2> bars;
+
+  std::array<BarGeometry, 2> paintedGeometry;
+
   Colour lowColour;
   Colour highColour;
   ColourGradient topGradient;
   ColourGradient bottomGradient;
 
+  std::array<float, 2> value = { { 0.f, 0.f } };
   std::array<float, 2> minValue = { { 0.f, 0.f } };
   std::array<float, 2> maxValue = { { 0.f, 0.f } };
+
+  MeterBus::Snapshot snapshot;
 };
\ No newline at end of file
@@ -0,0 +1,112 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "SharedStateObject.h"
+#include <JuceHeader.h>
+
+/**
+ * The class GestureThrottle limits the rate at which the changes made by the
+ * gui during a gesture, like dragging a knot of a SplineEditor, are sent to
+ * the host. Instead of notifying the host on each mouse event, an attachment
+ * schedules its latest value, and all the scheduled values are sent once per
+ * display frame. The attachment flushes its own value when the gesture ends,
+ * so the final value is always delivered.
+ * There is one GestureThrottle for each AudioProcessorValueTreeState, see
+ * GestureThrottle::getFor. It is used only on the message thread.
+ */
+class GestureThrottle : private Timer
+{
+public:
+  static constexpr int framesPerSecond = 60;
+
+  class Client
+  {
+  public:
+    virtual ~Client() = default;
+
+    /**
+     * Called when the scheduled value of the client has to be sent to the
+     * host.
+     */
+    virtual void sendScheduledValue() = 0;
+
+  private:
+    friend class GestureThrottle;
+    bool isScheduled = false;
+  };
+
+  explicit GestureThrottle(AudioProcessorValueTreeState&) {}
+
+  static std::shared_ptr<GestureThrottle> getFor(
+    AudioProcessorValueTreeState& state)
+  {
+    return getSharedObjectForState<GestureThrottle>(state);
+  }
+
+  /**
+   * Schedules the client to send its value at the next frame.
+   */
+  void schedule(Client& client)
+  {
+    if (client.isScheduled) {
+      return;
+    }
+    client.isScheduled = true;
+    scheduled.add(&client);
+    if (!isTimerRunning()) {
+      startTimerHz(framesPerSecond);
+    }
+  }
+
+  /**
+   * Sends the scheduled value of a client immediately, if there is one.
+   */
+  void flush(Client& client)
+  {
+    if (!client.isScheduled) {
+      return;
+    }
+    client.isScheduled = false;
+    scheduled.removeFirstMatchingValue(&client);
+    client.sendScheduledValue();
+  }
+
+  /**
+   * Sends all the scheduled values.
+   */
+  void flush()
+  {
+    // sending a value may schedule or flush other clients
+    while (!scheduled.isEmpty()) {
+      auto* client = scheduled.removeAndReturn(0);
+      client->isScheduled = false;
+      client->sendScheduledValue();
+    }
+  }
+
+private:
+  void timerCallback() override
+  {
+    flush();
+    stopTimer();
+  }
+
+  Array<Client*> scheduled;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GestureThrottle)
+};
@@ -17,8 +17,12 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
 #include "AttachedControls.h"
+#include "Attachments.h"
+#include "ParameterRegistry.h"
 #include "WrappedBoolParameter.h"
 #include <array>
+#include <utility>
+#include <vector>
 
 /**
  * These classes are designed to have different values for a setting of a
@@ -28,13 +32,17 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
  * true, the two parameters are "linked", meaning that the value of the first
  * one is used for both channels; when the bool parameter is false, each channel
  * has its own value.
+ * The same holds for more than two channels: when linked, all the channels use
+ * the value of the first one.
  */
 
-template<class ParameterClass>
+template<class ParameterClass, int numChannels_ = 2>
 struct LinkableParameter
 {
+  static constexpr int numChannels = numChannels_;
+
   WrappedBoolParameter linked;
-  std::array<ParameterClass*, 2> parameters;
+  std::array<ParameterClass*, numChannels> parameters;
 
   String const& getID(int channel) { return parameters[channel]->paramID; }
 
@@ -45,13 +53,37 @@ struct LinkableParameter
     }
     return parameters[channel];
   }
+
+  /**
+   * Returns the values of all the channels in the lanes of a SIMD vector, e.g.
+   * a Vec4f for 4 channels, applying the link flag once. The lanes beyond the
+   * number of channels are set to zero.
+   */
+  template<class Vec>
+  Vec gather()
+  {
+    static_assert(Vec::size() >= numChannels,
+                  "The vector must have a lane for each channel.");
+    using Scalar = decltype(std::declval<Vec>().extract(0));
+    if (linked.getValue()) {
+      Vec vec = Vec((Scalar)parameters[0]->get());
+      return vec.cutoff(numChannels);
+    }
+    alignas(64) Scalar values[Vec::size()] = {};
+    for (int c = 0; c < numChannels; ++c) {
+      values[c] = (Scalar)parameters[c]->get();
+    }
+    return Vec().load_a(values);
+  }
 };
 
-template<>
-struct LinkableParameter<WrappedBoolParameter>
+template<int numChannels_>
+struct LinkableParameter<WrappedBoolParameter, numChannels_>
 {
+  static constexpr int numChannels = numChannels_;
+
   WrappedBoolParameter linked;
-  std::array<WrappedBoolParameter, 2> parameters;
+  std::array<WrappedBoolParameter, numChannels> parameters;
 
   String const& getID(int channel)
   {
@@ -67,6 +99,86 @@ struct LinkableParameter<WrappedBoolParameter>
   }
 };
 
+/**
+ * The class ResolvedLinkables evaluates the link flags of a set of
+ * LinkableParameter once per block, and stores the resulting values of each
+ * channel in a dense array, so that the processing code can read them with no
+ * branches and no indirections. The values are read from the raw values of
+ * the AudioProcessorValueTreeState, so they are not normalised.
+ * The parameters are added with ResolvedLinkables::add before the processing
+ * starts, and the audio thread calls ResolvedLinkables::resolve at the start of
+ * each block.
+ */
+class ResolvedLinkables
+{
+public:
+  explicit ResolvedLinkables(AudioProcessorValueTreeState& apvts)
+    : registry(ParameterRegistry::getFor(apvts))
+  {}
+
+  /**
+   * Adds a linkable parameter, returning its index in the arrays of values.
+   */
+  template<class ParameterClass>
+  int add(LinkableParameter<ParameterClass>& linkable)
+  {
+    sources.push_back(
+      { BoolParameterHandle(
+          registry->getRawParameterValue(linkable.linked.getID()),
+          getBoolParameterThreshold(linkable.linked.getParameter())),
+        { { registry->getRawParameterValue(linkable.getID(0)),
+            registry->getRawParameterValue(linkable.getID(1)) } } });
+    jassert(sources.back().linked.isValid() && sources.back().values[0] &&
+            sources.back().values[1]);
+    for (auto& channelValues : values) {
+      channelValues.push_back(0.f);
+    }
+    return (int)sources.size() - 1;
+  }
+
+  /**
+   * Reads all the values, applying the link flags. To be called by the audio
+   * thread once per block.
+   */
+  void resolve()
+  {
+    int const numSources = (int)sources.size();
+    float* const values0 = values[0].data();
+    float* const values1 = values[1].data();
+    for (int i = 0; i < numSources; ++i) {
+      auto const& source = sources[i];
+      bool const isLinked = source.linked.get();
+      float const value0 = source.values[0]->load(std::memory_order_relaxed);
+      float const value1 = source.values[1]->load(std::memory_order_relaxed);
+      values0[i] = value0;
+      values1[i] = isLinked ? value0 : value1;
+    }
+  }
+
+  /**
+   * Returns the values of all the parameters for a channel, in the order in
+   * which they were added.
+   */
+  float const* getValues(int channel) const { return values[channel].data(); }
+
+  float get(int index, int channel) const { return values[channel][index]; }
+
+  int getNumParameters() const { return (int)sources.size(); }
+
+private:
+  struct Source
+  {
+    BoolParameterHandle linked;
+    std::array<std::atomic<float>*, 2> values;
+  };
+
+  std::shared_ptr<ParameterRegistry> registry;
+  std::vector<Source> sources;
+  std::array<std::vector<float>, 2> values;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResolvedLinkables)
+};
+
 struct LinkableControlTable
 {
   Colour backgroundColour = Colours::transparentBlack;
@@ -76,7 +188,12 @@ struct LinkableControlTable
 
   void paintTable(Graphics& g, int width, int height, bool hasLinked)
   {
-    int const rowHeight = (int)(hasLinked ? height / 4.f : height / 3.f);
+    paintTable(g, width, height, hasLinked ? 4 : 3);
+  }
+
+  void paintTable(Graphics& g, int width, int height, int numRows)
+  {
+    float const rowHeight = height / (float)numRows;
 
     g.fillAll(backgroundColour);
 
@@ -85,27 +202,38 @@ struct LinkableControlTable
     g.drawRect(0, 0, width, height);
 
     if (drawHorizontalLines) {
-      g.drawRect(0, 0, width, rowHeight);
-      g.drawRect(0, 0, width, 2 * rowHeight);
-      if (hasLinked) {
-        g.drawRect(0, 0, width, 3 * rowHeight);
+      for (int row = 1; row < numRows; ++row) {
+        g.drawRect(0, 0, width, (int)(row * rowHeight));
       }
     }
   }
 };
 
-template<class AttachedControlClass>
-class LinkableControl
-  : public Component
-  , public AudioProcessorValueTreeState::Listener
+/**
+ * A label, a control for each channel, and optionally a toggle for the link
+ * parameter, in a column. With more than two channels the rows are more
+ * compact.
+ */
+template<class AttachedControlClass, int numChannels = 2>
+class LinkableControl : public Component
 {
+  struct LinkCallback
+  {
+    LinkableControl* control;
+    void operator()() const { control->updateLinkedControl(); }
+  };
+
 protected:
   std::unique_ptr<AttachedToggle> linked;
-  std::array<AttachedControlClass, 2> controls;
+  std::array<AttachedControlClass, numChannels> controls;
   Label label;
-  std::array<String, 2> paramIDs;
+  std::array<String, numChannels> paramIDs;
   String linkParamID;
   AudioProcessorValueTreeState* apvts;
+  std::shared_ptr<ParameterRegistry> registry;
+  // the changes of the link parameter come through the AttachmentDispatcher,
+  // so they are coalesced and held during a BulkParameterUpdate
+  std::unique_ptr<TypedBoolAttachment<LinkCallback>> linkAttachment;
 
 public:
   LinkableControlTable tableSettings;
@@ -118,44 +246,103 @@ public:
                   String const& channel0ParamID,
                   String const& channel1ParamID,
                   bool makeLinkedControl = true)
+    : LinkableControl(apvts,
+                      name,
+                      linkParamID,
+                      std::array<String, numChannels>{
+                        { channel0ParamID, channel1ParamID } },
+                      makeLinkedControl)
+  {
+    static_assert(numChannels == 2, "Use the constructor with an array of IDs");
+  }
+
+  LinkableControl(AudioProcessorValueTreeState& apvts,
+                  String const& name,
+                  String const& linkParamID,
+                  std::array<String, numChannels> const& channelParamIDs,
+                  bool makeLinkedControl = true)
     : linked(makeLinkedControl
                ? std::make_unique<AttachedToggle>(*this, apvts, linkParamID)
                : nullptr)
-    , controls{ { { *this, apvts, channel0ParamID },
-                  { *this, apvts, channel0ParamID } } }
+    , controls(makeControls(*this,
+                            apvts,
+                            channelParamIDs[0],
+                            std::make_index_sequence<numChannels>()))
     , label("", name)
-    , paramIDs{ { channel0ParamID, channel1ParamID } }
+    , paramIDs(channelParamIDs)
     , linkParamID(linkParamID)
     , apvts(&apvts)
+    , registry(ParameterRegistry::getFor(apvts))
   {
-    parameterChanged("", apvts.getParameter(linkParamID)->getValue());
-    apvts.addParameterListener(linkParamID, this);
+    linkAttachment =
+      makeBoolAttachment(apvts, linkParamID, LinkCallback{ this });
+    updateLinkedControl();
 
     addAndMakeVisible(label);
     label.setJustificationType(Justification::centred);
 
     setOpaque(false);
-    setSize(90, linked ? 120 : 90);
+    setSize(90, (numChannels > 2 ? 20 : 30) * getNumRows());
   }
 
   template<class ParameterClass>
-  LinkableControl(AudioProcessorValueTreeState& apvts,
-                  String const& name,
-                  LinkableParameter<ParameterClass>& linkableParameters)
+  LinkableControl(
+    AudioProcessorValueTreeState& apvts,
+    String const& name,
+    LinkableParameter<ParameterClass, numChannels>& linkableParameters)
     : LinkableControl(apvts,
                       name,
                       linkableParameters.linked.getID(),
-                      linkableParameters.getID(0),
-                      linkableParameters.getID(1),
+                      getIDs(linkableParameters),
                       true)
   {}
 
-  ~LinkableControl() { apvts->removeParameterListener(linkParamID, this); }
+  /**
+   * Binds the existing controls to other parameters. The controls and their
+   * attachments are not recreated.
+   */
+  void setParameters(String const& newLinkParamID,
+                     String const& channel0ParamID,
+                     String const& channel1ParamID)
+  {
+    static_assert(numChannels == 2, "Use the overload with an array of IDs");
+    setParameters(newLinkParamID,
+                  std::array<String, numChannels>{
+                    { channel0ParamID, channel1ParamID } });
+  }
 
-  void parameterChanged(const String&, float newValue) override
+  void setParameters(String const& newLinkParamID,
+                     std::array<String, numChannels> const& channelParamIDs)
   {
-    bool const isLinked = newValue >= 0.5f;
-    controls[1].setParameter(paramIDs[isLinked ? 0 : 1]);
+    paramIDs = channelParamIDs;
+
+    controls[0].setParameter(paramIDs[0]);
+
+    if (newLinkParamID != linkParamID) {
+      linkParamID = newLinkParamID;
+      if (linked) {
+        linked->setParameter(linkParamID);
+      }
+      linkAttachment->rebind(linkParamID);
+    }
+
+    updateLinkedControl();
+  }
+
+  /**
+   * Binds the controls of the channels other than the first one to the
+   * parameter of the first one if the channels are linked, or to their own
+   * parameters otherwise.
+   */
+  void updateLinkedControl()
+  {
+    if (!linkAttachment) {
+      return; // still being constructed
+    }
+    bool const isLinked = linkAttachment->getValue();
+    for (int c = 1; c < numChannels; ++c) {
+      controls[c].setParameter(paramIDs[isLinked ? 0 : c]);
+    }
   }
 
   ToggleButton* getLinked() { return linked ? &linked->getControl() : nullptr; }
@@ -170,14 +357,16 @@ public:
     using Track = Grid::TrackInfo;
     grid.templateColumns = { Track(1_fr) };
 
-    for (int i = 0; i < (linked ? 4 : 3); ++i) {
+    int const numRows = getNumRows();
+
+    for (int i = 0; i < numRows; ++i) {
       grid.templateRows.add(Track(1_fr));
     }
 
-    int const rowHeight =
-      (int)(linked ? (getHeight()) / 4.f : (getHeight()) / 3.f);
+    int const rowHeight = (int)(getHeight() / (float)numRows);
 
-    constexpr int controlGap = std::is_same_v<Control, Slider> ? 0 : 4;
+    constexpr int controlGap =
+      std::is_same_v<Control, Slider> || numChannels > 2 ? 0 : 4;
 
     float const witdh = (float)std::is_same_v<Control, ToggleButton>
                           ? 26
@@ -186,18 +375,16 @@ public:
     grid.items = { GridItem(label)
                      .withWidth(getWidth() - 2 * tableSettings.gap)
                      .withAlignSelf(GridItem::AlignSelf::center)
-                     .withJustifySelf(GridItem::JustifySelf::center),
-                   GridItem(controls[0].getControl())
-                     .withWidth(witdh)
-                     .withHeight(rowHeight - 2.f * controlGap)
-                     .withAlignSelf(GridItem::AlignSelf::center)
-                     .withJustifySelf(GridItem::JustifySelf::center),
-                   GridItem(controls[1].getControl())
-                     .withWidth(witdh)
-                     .withHeight(rowHeight - 2.f * controlGap)
-                     .withAlignSelf(GridItem::AlignSelf::center)
                      .withJustifySelf(GridItem::JustifySelf::center) };
 
+    for (auto& control : controls) {
+      grid.items.add(GridItem(control.getControl())
+                       .withWidth(witdh)
+                       .withHeight(rowHeight - 2.f * controlGap)
+                       .withAlignSelf(GridItem::AlignSelf::center)
+                       .withJustifySelf(GridItem::JustifySelf::center));
+    }
+
     if (linked) {
       grid.items.add(GridItem(linked->getControl())
                        .withWidth(26)
@@ -210,7 +397,34 @@ public:
 
   void paint(Graphics& g) override
   {
-    tableSettings.paintTable(g, getWidth(), getHeight(), linked ? true : false);
+    tableSettings.paintTable(g, getWidth(), getHeight(), getNumRows());
+  }
+
+private:
+  int getNumRows() const { return 1 + numChannels + (linked ? 1 : 0); }
+
+  template<size_t... channel>
+  static std::array<AttachedControlClass, numChannels> makeControls(
+    Component& owner,
+    AudioProcessorValueTreeState& apvts,
+    String const& paramID,
+    std::index_sequence<channel...>)
+  {
+    // all the controls start attached to the first channel, see
+    // updateLinkedControl
+    return { { ((void)channel,
+                AttachedControlClass(owner, apvts, paramID))... } };
+  }
+
+  template<class ParameterClass>
+  static std::array<String, numChannels> getIDs(
+    LinkableParameter<ParameterClass, numChannels>& linkableParameters)
+  {
+    std::array<String, numChannels> ids;
+    for (int c = 0; c < numChannels; ++c) {
+      ids[c] = linkableParameters.getID(c);
+    }
+    return ids;
   }
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LinkableControl)
@@ -242,7 +456,7 @@ public:
     this->controls[1] =
       AttachedComboBox(*this, apvts, channel0ParamID, choices);
 
-    parameterChanged("", *apvts.getRawParameterValue(linkParamID));
+    this->updateLinkedControl();
   }
 
   template<class ParameterClass>
@@ -262,14 +476,13 @@ public:
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LinkableComboBox)
 };
 
-class ChannelLabels
-  : public Component
-  , public AudioProcessorValueTreeState::Listener
+class ChannelLabels : public Component
 {
   std::array<Label, 2> labels;
   std::unique_ptr<Label> linkLabel;
   String midSideParamID;
   AudioProcessorValueTreeState* apvts;
+  std::unique_ptr<BoolAttachment> midSideAttachment;
 
 public:
   LinkableControlTable tableSettings;
@@ -282,8 +495,9 @@ public:
     , labels{ { Label("", "Left"), Label("", "Right") } }
     , linkLabel(makeLinkLabel ? std::make_unique<Label>("", "Link") : nullptr)
   {
-    parameterChanged("", apvts.getParameter(midSideParamID)->getValue());
-    apvts.addParameterListener(midSideParamID, this);
+    midSideAttachment = BoolAttachment::make(
+      apvts, midSideParamID, [this] { updateLabels(); });
+    updateLabels();
     for (int c = 0; c < 2; ++c) {
       addAndMakeVisible(labels[c]);
       labels[c].setJustificationType(Justification::centred);
@@ -294,11 +508,12 @@ public:
     }
   }
 
-  ~ChannelLabels() { apvts->removeParameterListener(midSideParamID, this); }
-
-  void parameterChanged(const String&, float newValue) override
+  void updateLabels()
   {
-    bool const isMidSide = newValue >= 0.5f;
+    if (!midSideAttachment) {
+      return; // still being constructed
+    }
+    bool const isMidSide = midSideAttachment->getValue();
     labels[0].setText(isMidSide ? "Mid" : "Left", dontSendNotification);
     labels[1].setText(isMidSide ? "Side" : "Right", dontSendNotification);
   }
@@ -0,0 +1,200 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "LoudnessMeter.h"
+
+namespace {
+
+// ITU-R BS.1770-4, Annex 2: the i-th element of the array holds the
+// coefficients of the i-th tap of the four phases of the interpolator.
+Vec4f const truePeakCoefficients[TruePeakDetector::numTaps] = {
+  { 0.001708984375f, -0.0291748046875f, -0.0189208984375f, -0.00830078125f },
+  { 0.010986328125f, 0.029296875f, 0.0330810546875f, 0.014892578125f },
+  { -0.0196533203125f, -0.0517578125f, -0.0582275390625f, -0.026611328125f },
+  { 0.033203125f, 0.089111328125f, 0.1015625f, 0.047607421875f },
+  { -0.0594482421875f, -0.16650390625f, -0.2003173828125f, -0.102294921875f },
+  { 0.1373291015625f, 0.465087890625f, 0.77978515625f, 0.97216796875f },
+  { 0.97216796875f, 0.77978515625f, 0.465087890625f, 0.1373291015625f },
+  { -0.102294921875f, -0.2003173828125f, -0.16650390625f, -0.0594482421875f },
+  { 0.047607421875f, 0.1015625f, 0.089111328125f, 0.033203125f },
+  { -0.026611328125f, -0.0582275390625f, -0.0517578125f, -0.0196533203125f },
+  { 0.014892578125f, 0.0330810546875f, 0.029296875f, 0.010986328125f },
+  { -0.00830078125f, -0.0189208984375f, -0.0291748046875f, 0.001708984375f }
+};
+
+float
+energyToDecibels(double energy)
+{
+  return energy > 0.0 ? (float)(10.0 * std::log10(energy)) : -100.f;
+}
+
+} // namespace
+
+float
+TruePeakDetector::processBlock(float const* input, int numSamples)
+{
+  Vec4f peak = 0.f;
+
+  for (int i = 0; i < numSamples; ++i) {
+    position = position == 0 ? numTaps - 1 : position - 1;
+    history[position] = history[position + numTaps] = input[i];
+
+    float const* window = &history[position];
+    Vec4f interpolated = truePeakCoefficients[0] * window[0];
+    for (int k = 1; k < numTaps; ++k) {
+      interpolated = mul_add(truePeakCoefficients[k], window[k], interpolated);
+    }
+
+    peak = max(peak, abs(interpolated));
+  }
+
+  return horizontal_max(peak);
+}
+
+void
+TruePeakDetector::reset()
+{
+  std::fill(history.begin(), history.end(), 0.f);
+  position = 0;
+}
+
+void
+LoudnessMeter::Biquad::setup(double b0,
+                             double b1,
+                             double b2,
+                             double a1,
+                             double a2)
+{
+  this->b0 = b0;
+  this->b1 = b1;
+  this->b2 = b2;
+  this->a1 = a1;
+  this->a2 = a2;
+}
+
+LoudnessMeter::LoudnessMeter(double sampleRate)
+{
+  setSampleRate(sampleRate);
+}
+
+void
+LoudnessMeter::setSampleRate(double sampleRate)
+{
+  // K-weighting filters of ITU-R BS.1770, redesigned for any sample rate
+
+  {
+    double const f0 = 1681.974450955533;
+    double const gainDb = 3.999843853973347;
+    double const q = 0.7071752369554196;
+    double const k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+    double const vh = std::pow(10.0, gainDb / 20.0);
+    double const vb = std::pow(vh, 0.4996667741545416);
+    double const a0 = 1.0 + k / q + k * k;
+    highShelf.setup((vh + vb * k / q + k * k) / a0,
+                    2.0 * (k * k - vh) / a0,
+                    (vh - vb * k / q + k * k) / a0,
+                    2.0 * (k * k - 1.0) / a0,
+                    (1.0 - k / q + k * k) / a0);
+  }
+
+  {
+    double const f0 = 38.13547087602444;
+    double const q = 0.5003270373238773;
+    double const k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+    double const a0 = 1.0 + k / q + k * k;
+    highPass.setup(1.0,
+                   -2.0,
+                   1.0,
+                   2.0 * (k * k - 1.0) / a0,
+                   (1.0 - k / q + k * k) / a0);
+  }
+
+  samplesPerBlock = jmax(1, roundToInt(0.1 * sampleRate));
+
+  reset();
+}
+
+void
+LoudnessMeter::reset()
+{
+  highShelf.s1 = highShelf.s2 = highPass.s1 = highPass.s2 = 0.0;
+  for (auto& detector : truePeakDetectors) {
+    detector.reset();
+  }
+  std::fill(blockEnergies.begin(), blockEnergies.end(), 0.0);
+  blockIndex = 0;
+  samplesInCurrentBlock = 0;
+  currentBlockEnergy = 0.0;
+  momentaryLoudness = shortTermLoudness = -100.f;
+  truePeak[0] = truePeak[1] = -100.f;
+}
+
+void
+LoudnessMeter::processBlock(float const* const* input, int numSamples)
+{
+  for (int c = 0; c < 2; ++c) {
+    float const peak = truePeakDetectors[c].processBlock(input[c], numSamples);
+    truePeak[c] = Decibels::gainToDecibels(peak, -100.f);
+  }
+
+  for (int i = 0; i < numSamples; ++i) {
+    Vec2d const x = highPass.process(highShelf.process(
+      Vec2d((double)input[0][i], (double)input[1][i])));
+
+    currentBlockEnergy = mul_add(x, x, currentBlockEnergy);
+
+    if (++samplesInCurrentBlock == samplesPerBlock) {
+      blockEnergies[blockIndex] =
+        horizontal_add(currentBlockEnergy) / (double)samplesPerBlock;
+      blockIndex = (blockIndex + 1) % numShortTermBlocks;
+      samplesInCurrentBlock = 0;
+      currentBlockEnergy = 0.0;
+      updateLoudness();
+    }
+  }
+}
+
+void
+LoudnessMeter::updateLoudness()
+{
+  double shortTermEnergy = 0.0;
+  double momentaryEnergy = 0.0;
+
+  for (int i = 1; i <= numShortTermBlocks; ++i) {
+    double const energy =
+      blockEnergies[(blockIndex - i + numShortTermBlocks) % numShortTermBlocks];
+    shortTermEnergy += energy;
+    if (i <= numMomentaryBlocks) {
+      momentaryEnergy += energy;
+    }
+  }
+
+  momentaryLoudness =
+    -0.691f + energyToDecibels(momentaryEnergy / numMomentaryBlocks);
+
+  shortTermLoudness =
+    -0.691f + energyToDecibels(shortTermEnergy / numShortTermBlocks);
+}
+
+void
+LoudnessMeter::setOnBus(MeterBus& bus, int firstIndex) const
+{
+  bus.set(firstIndex + momentaryLoudnessOffset, momentaryLoudness);
+  bus.set(firstIndex + shortTermLoudnessOffset, shortTermLoudness);
+  bus.set(firstIndex + truePeakOffset, truePeak[0]);
+  bus.set(firstIndex + truePeakOffset + 1, truePeak[1]);
+}
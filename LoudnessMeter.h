@@ -0,0 +1,136 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "MeterBus.h"
+#include "avec/Avec.hpp"
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ * Metering kernels for ITU-R BS.1770 loudness and true peak, meant to run on
+ * the audio thread of the processor whose gain is shown by a GainVuMeter.
+ * The results are sent to the editor through a MeterBus, like the values
+ * shown by any other meter-like component.
+ */
+
+/**
+ * 4x oversampled true peak detector for a single channel, using the
+ * interpolation filter of Annex 2 of ITU-R BS.1770. The four phases of the
+ * polyphase filter are computed at once in a Vec4f.
+ * The filter is specified by the recommendation itself, so it does not use
+ * the oversamplers from oversimple, whose filters are designed for a different
+ * purpose.
+ */
+class TruePeakDetector
+{
+public:
+  static constexpr int numTaps = 12;
+
+  /**
+   * Processes a block of samples, returning the peak absolute value of the
+   * interpolated signal.
+   */
+  float processBlock(float const* input, int numSamples);
+
+  void reset();
+
+private:
+  // the last numTaps samples, stored twice so that a contiguous window of
+  // numTaps samples, from the newest to the oldest, always starts at position
+  std::array<float, 2 * numTaps> history{};
+  int position = 0;
+};
+
+/**
+ * Stereo loudness and true peak meter. Loudness is K-weighted and summed over
+ * both channels, as specified by ITU-R BS.1770 for left/right signals. The two
+ * channels are processed together in a Vec2d.
+ */
+class LoudnessMeter
+{
+public:
+  static constexpr int numShortTermBlocks = 30;
+  static constexpr int numMomentaryBlocks = 4;
+
+  /**
+   * Offsets of the values set on a MeterBus by setOnBus, relative to the first
+   * index.
+   */
+  enum BusOffset
+  {
+    momentaryLoudnessOffset = 0,
+    shortTermLoudnessOffset,
+    truePeakOffset, // followed by the true peak of the second channel
+    numBusValues = truePeakOffset + 2
+  };
+
+  LoudnessMeter(double sampleRate = 48000.0);
+
+  void setSampleRate(double sampleRate);
+
+  void reset();
+
+  void processBlock(float const* const* input, int numSamples);
+
+  /**
+   * Sets the loudness, in LUFS, and the true peak of the last block, in dBTP,
+   * on the bus, starting from firstIndex. It is up to the caller to publish
+   * them, together with the values of the other meters.
+   */
+  void setOnBus(MeterBus& bus, int firstIndex) const;
+
+  float getMomentaryLoudness() const { return momentaryLoudness; }
+  float getShortTermLoudness() const { return shortTermLoudness; }
+  float getTruePeak(int channel) const { return truePeak[channel]; }
+
+private:
+  struct Biquad
+  {
+    Vec2d b0, b1, b2, a1, a2;
+    Vec2d s1 = 0.0;
+    Vec2d s2 = 0.0;
+
+    void setup(double b0, double b1, double b2, double a1, double a2);
+
+    Vec2d process(Vec2d x)
+    {
+      Vec2d const y = mul_add(b0, x, s1);
+      s1 = mul_add(b1, x, s2) - a1 * y;
+      s2 = b2 * x - a2 * y;
+      return y;
+    }
+  };
+
+  void updateLoudness();
+
+  Biquad highShelf;
+  Biquad highPass;
+
+  std::array<TruePeakDetector, 2> truePeakDetectors;
+
+  // mean square of the K-weighted signal of the last 100ms blocks
+  std::array<double, numShortTermBlocks> blockEnergies{};
+  int blockIndex = 0;
+  int samplesPerBlock = 4800;
+  int samplesInCurrentBlock = 0;
+  Vec2d currentBlockEnergy = 0.0;
+
+  float momentaryLoudness = -100.f;
+  float shortTermLoudness = -100.f;
+  std::array<float, 2> truePeak{ { -100.f, -100.f } };
+};
@@ -0,0 +1,112 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#ifndef JUICY_METER_BUS_CAPACITY
+#define JUICY_METER_BUS_CAPACITY 32
+#endif
+
+/**
+ * A bus to send the values of all the meters of a processor to its editor.
+ * The audio thread sets the values with MeterBus::set and publishes them all
+ * at once with MeterBus::publish, once per block. The values are protected by
+ * a sequence counter (a seqlock), so the meters always read a consistent
+ * snapshot, in which all values come from the same block, without the audio
+ * thread ever waiting for them. Each meter-like component of this library is
+ * given the bus and the indices of the values it shows.
+ */
+class MeterBus
+{
+public:
+  static constexpr int capacity = JUICY_METER_BUS_CAPACITY;
+
+  struct Snapshot
+  {
+    std::array<float, capacity> values{};
+    // the sequence number of the publication the values come from
+    uint32_t sequence = 0;
+
+    float operator[](int index) const { return values[index]; }
+  };
+
+  /**
+   * Sets a value, which will be seen by the meters after the next call to
+   * publish. To be called only by the audio thread.
+   */
+  void set(int index, float value)
+  {
+    jassert(index >= 0 && index < capacity);
+    staged[index] = value;
+  }
+
+  /**
+   * Publishes all the values set since the last publication. To be called only
+   * by the audio thread, usually at the end of each block.
+   */
+  void publish()
+  {
+    uint32_t const current = sequence.load(std::memory_order_relaxed);
+    sequence.store(current + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < capacity; ++i) {
+      published[i].store(staged[i], std::memory_order_relaxed);
+    }
+    sequence.store(current + 2, std::memory_order_release);
+  }
+
+  /**
+   * Reads a consistent snapshot of the last published values. It can be called
+   * by any thread other than the audio thread.
+   */
+  void read(Snapshot& snapshot) const
+  {
+    for (;;) {
+      uint32_t const before = sequence.load(std::memory_order_acquire);
+      if (before & 1) {
+        // a publication is in progress, and it takes only a few nanoseconds
+        continue;
+      }
+      for (int i = 0; i < capacity; ++i) {
+        snapshot.values[i] = published[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence.load(std::memory_order_relaxed) == before) {
+        snapshot.sequence = before;
+        return;
+      }
+    }
+  }
+
+  /**
+   * Returns the sequence number of the last publication, so that a meter can
+   * skip reading and redrawing if nothing was published since its last frame.
+   */
+  uint32_t getSequence() const
+  {
+    return sequence.load(std::memory_order_acquire);
+  }
+
+private:
+  std::array<float, capacity> staged{};
+  alignas(64) std::atomic<uint32_t> sequence{ 0 };
+  std::array<std::atomic<float>, capacity> published{};
+};
@@ -0,0 +1,128 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Benchmarks.h"
+#include "SharedOversamplingContext.h"
+#include <JuceHeader.h>
+#include <ostream>
+
+/**
+ * Benchmarks oversimple::Oversampling over orders 0 to 5, minimum and linear
+ * phase, 1, 2 and 8 channels, and blocks of 32 to 4096 samples, configured as
+ * OversamplingAttachments configures it: the order and the phase mode are set
+ * on a copy of the base settings. For each configuration it reports the cost
+ * of an upsampling and downsampling round trip per sample per channel, the
+ * latency, and the time to build an instance, which is the time it takes to
+ * reconfigure.
+ * The Resampler template adapts the oversimple::Oversampling interface, as in
+ * SharedOversamplingContext, and it must also provide:
+ * @code
+ * // sets the number of channels and the maximum block size
+ * static void configure(oversimple::OversamplingSettings& settings,
+ *                       int numChannels,
+ *                       int maxNumSamples);
+ * // returns the latency, in samples at the base sample rate
+ * static int getLatency(oversimple::Oversampling<Scalar>& oversampling);
+ * @endcode
+ */
+template<typename Scalar, class Resampler>
+void
+benchmarkOversampling(std::ostream& output,
+                      oversimple::OversamplingSettings baseSettings,
+                      double sampleRate = 48000.0)
+{
+  char const* const scalarName =
+    std::is_same_v<Scalar, float> ? "float" : "double";
+  int const numSamples = (int)sampleRate;
+
+  for (int numChannels : { 1, 2, 8 }) {
+    AudioBuffer<Scalar> noise(numChannels, numSamples);
+    Random random(1);
+    for (int c = 0; c < numChannels; ++c) {
+      for (int i = 0; i < numSamples; ++i) {
+        noise.setSample(c, i, (Scalar)(random.nextFloat() * 2.f - 1.f));
+      }
+    }
+    AudioBuffer<Scalar> block(numChannels, 4096);
+
+    for (int blockSize = 32; blockSize <= 4096; blockSize *= 2) {
+      for (bool linearPhase : { false, true }) {
+        for (int order = 0; order <= 5; ++order) {
+          auto settings = baseSettings;
+          Resampler::configure(settings, numChannels, blockSize);
+          settings.order = order;
+          settings.linearPhase = linearPhase;
+
+          double const buildTime = benchmarks::measureNanoseconds(
+            [&] { oversimple::Oversampling<Scalar> discarded(settings); }, 3);
+
+          oversimple::Oversampling<Scalar> oversampling(settings);
+
+          double const processTime = benchmarks::measureNanoseconds(
+            [&] {
+              for (int i = 0; i < numSamples; i += blockSize) {
+                int const n = jmin(blockSize, numSamples - i);
+                for (int c = 0; c < numChannels; ++c) {
+                  block.copyFrom(c, 0, noise, c, i, n);
+                }
+                Scalar* const* upsampled = nullptr;
+                int const numUpsampled =
+                  Resampler::upsample(oversampling,
+                                      block.getArrayOfReadPointers(),
+                                      numChannels,
+                                      n,
+                                      upsampled);
+                Resampler::downsample(oversampling,
+                                      upsampled,
+                                      numUpsampled,
+                                      block.getArrayOfWritePointers(),
+                                      numChannels,
+                                      n);
+              }
+            },
+            5);
+
+          output << "{\"benchmark\":\"oversampling\",\"scalar\":\""
+                 << scalarName << "\",\"order\":" << order
+                 << ",\"linearPhase\":" << (linearPhase ? "true" : "false")
+                 << ",\"numChannels\":" << numChannels
+                 << ",\"blockSize\":" << blockSize
+                 << ",\"sampleRate\":" << sampleRate << ",\"nsPerSample\":"
+                 << processTime / ((double)numSamples * numChannels)
+                 << ",\"latency\":" << Resampler::getLatency(oversampling)
+                 << ",\"reconfigurationUs\":" << 1.0e-3 * buildTime << "}\n";
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Runs benchmarkOversampling with float and double.
+ */
+template<template<typename> class Resampler>
+void
+benchmarkOversampling(std::ostream& output,
+                      oversimple::OversamplingSettings baseSettings,
+                      double sampleRate = 48000.0)
+{
+  benchmarkOversampling<float, Resampler<float>>(
+    output, baseSettings, sampleRate);
+  benchmarkOversampling<double, Resampler<double>>(
+    output, baseSettings, sampleRate);
+}
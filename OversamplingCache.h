@@ -0,0 +1,149 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "oversimple/Oversampling.hpp"
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+/**
+ * An oversimple::Oversampling together with the order and the phase mode it
+ * was built with, and the generation of the rest of its settings, see
+ * OversamplingCache.
+ */
+template<typename Scalar>
+struct OversamplingInstance
+{
+  OversamplingInstance(oversimple::OversamplingSettings const& settings,
+                       uint32_t settingsGeneration)
+    : oversampling(settings)
+    , order(settings.order)
+    , linearPhase(settings.linearPhase)
+    , settingsGeneration(settingsGeneration)
+  {}
+
+  oversimple::Oversampling<Scalar> oversampling;
+  int const order;
+  bool const linearPhase;
+  uint32_t const settingsGeneration;
+};
+
+/**
+ * The class OversamplingCache keeps the oversimple::Oversampling instances
+ * that are not in use, keyed by their order and phase mode, so that switching
+ * back to an order used before does not design its filters again. The number
+ * of instances is bounded: when the cache is full the least recently used one
+ * is destroyed.
+ * All the cached instances share the same settings other than the order and
+ * the phase mode, identified by a generation number: instances of another
+ * generation are neither stored nor returned.
+ * The cache is not thread safe, its owner must serialize the calls to it. It
+ * must never be used by the audio thread.
+ */
+template<typename Scalar>
+class OversamplingCache
+{
+public:
+  using Instance = OversamplingInstance<Scalar>;
+
+  explicit OversamplingCache(int maxNumInstances = 0)
+    : maxNumInstances(maxNumInstances)
+  {}
+
+  void setMaxNumInstances(int newMaxNumInstances)
+  {
+    maxNumInstances = jmax(0, newMaxNumInstances);
+    while ((int)entries.size() > maxNumInstances) {
+      evictLeastRecentlyUsed();
+    }
+  }
+
+  int getMaxNumInstances() const { return maxNumInstances; }
+
+  /**
+   * Removes and returns the cached instance with the requested order, phase
+   * mode and settings generation, or nullptr if there is none.
+   */
+  std::unique_ptr<Instance> take(int order,
+                                 bool linearPhase,
+                                 uint32_t settingsGeneration)
+  {
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      auto& instance = *it->instance;
+      if (instance.order == order && instance.linearPhase == linearPhase &&
+          instance.settingsGeneration == settingsGeneration) {
+        auto taken = std::move(it->instance);
+        entries.erase(it);
+        return taken;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Resets an instance that is not in use anymore, and stores it. The instance
+   * is destroyed if the cache is disabled, if its generation is not the
+   * current one, or if there is already an instance with its order and phase
+   * mode.
+   */
+  void put(std::unique_ptr<Instance> instance, uint32_t settingsGeneration)
+  {
+    if (!instance || maxNumInstances == 0 ||
+        instance->settingsGeneration != settingsGeneration) {
+      return;
+    }
+    for (auto& entry : entries) {
+      if (entry.instance->order == instance->order &&
+          entry.instance->linearPhase == instance->linearPhase) {
+        entry.lastUse = ++useCounter;
+        return;
+      }
+    }
+    if ((int)entries.size() == maxNumInstances) {
+      evictLeastRecentlyUsed();
+    }
+    instance->oversampling.reset();
+    entries.push_back({ std::move(instance), ++useCounter });
+  }
+
+  void clear() { entries.clear(); }
+
+private:
+  struct Entry
+  {
+    std::unique_ptr<Instance> instance;
+    uint64_t lastUse;
+  };
+
+  void evictLeastRecentlyUsed()
+  {
+    auto leastRecentlyUsed = entries.begin();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (it->lastUse < leastRecentlyUsed->lastUse) {
+        leastRecentlyUsed = it;
+      }
+    }
+    if (leastRecentlyUsed != entries.end()) {
+      entries.erase(leastRecentlyUsed);
+    }
+  }
+
+  std::vector<Entry> entries;
+  int maxNumInstances;
+  uint64_t useCounter = 0;
+};
@@ -0,0 +1,316 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <functional>
+
+/**
+ * The class OversamplingCrossfade makes the change of an oversampling instance
+ * click-free. During a transition the processor runs its oversampled chain
+ * twice per block, once with the previous instance, writing into
+ * getPreviousOutput, and once with the new one, in place, and then calls
+ * process, which aligns the two outputs and crossfades between them.
+ * The two instances can have different latencies, so the output with the lower
+ * latency is delayed to match the other one while they are crossfaded. The
+ * delay is itself faded in and out, so that no samples are repeated or
+ * skipped:
+ * - if the new latency is higher, the previous output is first faded into a
+ * delayed copy of itself, and then into the new output. The host is told about
+ * the new latency when the transition begins.
+ * - if the new latency is lower, the previous output is faded into a delayed
+ * copy of the new output, which is then faded into the new output itself. The
+ * host is told about the new latency when the transition ends.
+ * To have the history needed to delay the previous output, process must also
+ * be called when there is no transition, so that the output is recorded.
+ * onLatencyChange is called on the message thread, to call
+ * AudioProcessor::setLatencySamples.
+ * Usage with OversamplingAttachments, with setKeepPreviousOversampling(true):
+ * @code
+ * auto* oversampling = attachments.getOversampling();
+ * auto* previous = attachments.getPreviousOversampling();
+ * if (previous && !crossfade.isInTransition()) {
+ *   crossfade.begin(latencyOf(*previous), latencyOf(*oversampling));
+ * }
+ * if (crossfade.needsPreviousOutput()) {
+ *   runChain(*previous, input, crossfade.getPreviousOutput());
+ * }
+ * runChain(*oversampling, input, output);
+ * if (crossfade.process(output, numChannels, numSamples)) {
+ *   attachments.releasePreviousOversampling();
+ * }
+ * @endcode
+ */
+template<typename Scalar>
+class OversamplingCrossfade : private AsyncUpdater
+{
+public:
+  /**
+   * Called on the message thread when the latency seen by the host changes,
+   * with the latency of the new instance.
+   */
+  std::function<void(int)> onLatencyChange;
+
+  ~OversamplingCrossfade() override { cancelPendingUpdate(); }
+
+  /**
+   * Allocates the buffers. Not to be called by the audio thread.
+   * @param maxLatencyDifference the maximum difference between the latencies
+   * of two instances, in samples at the base sample rate
+   */
+  void prepare(int numChannels, int maxBlockSize, int maxLatencyDifference)
+  {
+    previousOutput.setSize(numChannels, maxBlockSize);
+    delayedOutput.setSize(numChannels, maxBlockSize);
+    delayLine.setSize(numChannels, maxLatencyDifference + maxBlockSize);
+    delayLine.clear();
+    writePosition = 0;
+    stage = Stage::idle;
+    numStageSamplesLeft = 0;
+  }
+
+  /**
+   * Sets the length of each fade of a transition, in samples at the base
+   * sample rate.
+   */
+  void setTransitionLength(int numSamples)
+  {
+    transitionLength = jmax(1, numSamples);
+  }
+
+  /**
+   * Starts a transition. To be called by the audio thread, when there is no
+   * transition in progress.
+   */
+  void begin(int previousLatency, int newLatency)
+  {
+    jassert(!isInTransition());
+    delay = jmin(std::abs(newLatency - previousLatency),
+                 delayLine.getNumSamples() - previousOutput.getNumSamples());
+    isNewOutputDelayed = newLatency < previousLatency;
+    latency = newLatency;
+    if (newLatency > previousLatency) {
+      triggerAsyncUpdate();
+    }
+    if (!isNewOutputDelayed && delay > 0) {
+      startStage(Stage::realignPrevious);
+    }
+    else {
+      startStage(Stage::crossfade);
+    }
+  }
+
+  bool isInTransition() const { return stage != Stage::idle; }
+
+  /**
+   * True if the output of the previous instance is needed in the current
+   * block. It is not needed while the delay of the new output is faded out.
+   */
+  bool needsPreviousOutput() const
+  {
+    return stage == Stage::realignPrevious || stage == Stage::crossfade;
+  }
+
+  /**
+   * The buffer into which the previous instance writes its output during a
+   * transition.
+   */
+  Scalar* const* getPreviousOutput()
+  {
+    return previousOutput.getArrayOfWritePointers();
+  }
+
+  /**
+   * Aligns and crossfades the outputs of the previous and the new instance
+   * during a transition, writing the result over the output of the new one.
+   * Outside of a transition it only records the output. To be called by the
+   * audio thread once per block. Returns true if a transition ended in this
+   * block, in which case the previous instance can be released.
+   */
+  bool process(Scalar* const* output, int numChannels, int numSamples)
+  {
+    jassert(numChannels <= delayLine.getNumChannels());
+    jassert(numSamples <= previousOutput.getNumSamples());
+
+    int const delayLineSize = delayLine.getNumSamples();
+
+    if (!isInTransition()) {
+      for (int c = 0; c < numChannels; ++c) {
+        writeToDelayLine(c, output[c], numSamples);
+      }
+      writePosition = (writePosition + numSamples) % delayLineSize;
+      return false;
+    }
+
+    for (int c = 0; c < numChannels; ++c) {
+      writeToDelayLine(
+        c, isNewOutputDelayed ? output[c] : previousOutput.getReadPointer(c),
+        numSamples);
+      readFromDelayLine(c, delayedOutput.getWritePointer(c), numSamples);
+    }
+    writePosition = (writePosition + numSamples) % delayLineSize;
+
+    int offset = 0;
+    while (offset < numSamples && isInTransition()) {
+      int const numStageSamples =
+        jmin(numSamples - offset, numStageSamplesLeft);
+      for (int c = 0; c < numChannels; ++c) {
+        Scalar const* const newOutput = output[c];
+        Scalar const* const oldOutput = previousOutput.getReadPointer(c);
+        Scalar const* const delayed = delayedOutput.getReadPointer(c);
+        Scalar const* from = nullptr;
+        Scalar const* to = nullptr;
+        switch (stage) {
+          case Stage::realignPrevious:
+            from = oldOutput;
+            to = delayed;
+            break;
+          case Stage::crossfade:
+            from = isNewOutputDelayed || delay == 0 ? oldOutput : delayed;
+            to = isNewOutputDelayed && delay > 0 ? delayed : newOutput;
+            break;
+          default:
+            from = delayed;
+            to = newOutput;
+            break;
+        }
+        fade(from + offset,
+             to + offset,
+             output[c] + offset,
+             numStageSamplesLeft,
+             numStageSamples);
+      }
+      offset += numStageSamples;
+      numStageSamplesLeft -= numStageSamples;
+      if (numStageSamplesLeft == 0) {
+        nextStage();
+      }
+    }
+
+    if (!isInTransition()) {
+      if (isNewOutputDelayed) {
+        triggerAsyncUpdate();
+      }
+      return true;
+    }
+    return false;
+  }
+
+private:
+  enum class Stage
+  {
+    idle,
+    realignPrevious,
+    crossfade,
+    realignNew
+  };
+
+  void startStage(Stage newStage)
+  {
+    stage = newStage;
+    numStageSamplesLeft = transitionLength;
+    // when the new output is delayed, its delay line is empty, so it is faded
+    // in only after it is filled
+    if (stage == Stage::crossfade && isNewOutputDelayed) {
+      numStageSamplesLeft += delay;
+    }
+  }
+
+  void nextStage()
+  {
+    switch (stage) {
+      case Stage::realignPrevious:
+        startStage(Stage::crossfade);
+        break;
+      case Stage::crossfade:
+        if (isNewOutputDelayed && delay > 0) {
+          startStage(Stage::realignNew);
+        }
+        else {
+          stage = Stage::idle;
+        }
+        break;
+      default:
+        stage = Stage::idle;
+        break;
+    }
+  }
+
+  /**
+   * Linear fade from one signal to another, over transitionLength samples,
+   * of which numSamplesLeft are still to be done.
+   */
+  void fade(Scalar const* from,
+            Scalar const* to,
+            Scalar* output,
+            int numSamplesLeft,
+            int numSamples)
+  {
+    for (int i = 0; i < numSamples; ++i) {
+      Scalar const alpha =
+        numSamplesLeft >= transitionLength
+          ? Scalar(0)
+          : Scalar(1) - Scalar(numSamplesLeft) / Scalar(transitionLength);
+      output[i] = from[i] + alpha * (to[i] - from[i]);
+      --numSamplesLeft;
+    }
+  }
+
+  void writeToDelayLine(int channel, Scalar const* input, int numSamples)
+  {
+    int const delayLineSize = delayLine.getNumSamples();
+    int const firstPart = jmin(numSamples, delayLineSize - writePosition);
+    delayLine.copyFrom(channel, writePosition, input, firstPart);
+    if (firstPart < numSamples) {
+      delayLine.copyFrom(channel, 0, input + firstPart, numSamples - firstPart);
+    }
+  }
+
+  void readFromDelayLine(int channel, Scalar* destination, int numSamples)
+  {
+    int const delayLineSize = delayLine.getNumSamples();
+    Scalar const* const line = delayLine.getReadPointer(channel);
+    int readPosition = writePosition - delay;
+    if (readPosition < 0) {
+      readPosition += delayLineSize;
+    }
+    for (int i = 0; i < numSamples; ++i) {
+      destination[i] = line[readPosition];
+      if (++readPosition == delayLineSize) {
+        readPosition = 0;
+      }
+    }
+  }
+
+  void handleAsyncUpdate() override
+  {
+    if (onLatencyChange) {
+      onLatencyChange(latency.load());
+    }
+  }
+
+  AudioBuffer<Scalar> previousOutput;
+  AudioBuffer<Scalar> delayedOutput;
+  AudioBuffer<Scalar> delayLine;
+  int writePosition = 0;
+  int delay = 0;
+  bool isNewOutputDelayed = false;
+  int transitionLength = 1024;
+  Stage stage = Stage::idle;
+  int numStageSamplesLeft = 0;
+  std::atomic<int> latency{ 0 };
+};
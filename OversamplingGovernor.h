@@ -0,0 +1,179 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "OversamplingParameters.h"
+#include <JuceHeader.h>
+#include <atomic>
+
+/**
+ * The class OversamplingGovernor adapts the oversampling order to the CPU time
+ * available. The audio thread measures each block, between beginBlock and
+ * endBlock, against its deadline, the duration of the audio in the block. When
+ * the smoothed load stays above highLoad the order is lowered by one, and when
+ * it stays below lowLoad it is raised by one. After each step the governor
+ * holds for holdSeconds, so that the load settles at the new order. The order
+ * never leaves the bounds set with setBounds, and never exceeds the one of the
+ * parameter.
+ * The new order is applied by a timer on the message thread through
+ * OversamplingAttachments::setOrderOverride, so the instance is built in the
+ * background, and it can be crossfaded with OversamplingCrossfade.
+ */
+template<typename Scalar>
+class OversamplingGovernor : private Timer
+{
+public:
+  // these settings must be changed only while the audio thread is not running
+  float highLoad = 0.7f;
+  float lowLoad = 0.3f;
+  float holdSeconds = 1.f;
+  // the smoothing time of the measured load
+  float smoothingSeconds = 0.25f;
+
+  explicit OversamplingGovernor(OversamplingAttachments<Scalar>& attachments)
+    : attachments(attachments)
+  {
+    startTimerHz(10);
+  }
+
+  ~OversamplingGovernor() override
+  {
+    stopTimer();
+    attachments.setOrderOverride(-1);
+  }
+
+  /**
+   * Enables or disables the governor. When disabled, the order of the
+   * parameter is used.
+   */
+  void setEnabled(bool enabled) { isEnabled = enabled; }
+
+  /**
+   * Sets the lowest and the highest order the governor can choose.
+   */
+  void setBounds(int minOrder, int maxOrder)
+  {
+    this->minOrder = jmin(minOrder, maxOrder);
+    this->maxOrder = jmax(minOrder, maxOrder);
+  }
+
+  void prepareToPlay(double newSampleRate)
+  {
+    sampleRate = newSampleRate;
+    smoothedLoad = 0.f;
+    samplesSinceStep = 0;
+  }
+
+  /**
+   * Returns the order chosen by the governor, to show it in the gui.
+   */
+  int getEffectiveOrder() const { return effectiveOrder.load(); }
+
+  /**
+   * Returns the smoothed ratio between the processing time and the duration
+   * of the audio.
+   */
+  float getLoad() const { return load.load(); }
+
+  /**
+   * To be called by the audio thread at the start of each block.
+   */
+  void beginBlock() { blockStart = Time::getHighResolutionTicks(); }
+
+  /**
+   * To be called by the audio thread at the end of each block.
+   */
+  void endBlock(int numSamples)
+  {
+    if (numSamples <= 0) {
+      return;
+    }
+    double const elapsed = Time::highResolutionTicksToSeconds(
+      Time::getHighResolutionTicks() - blockStart);
+    double const deadline = numSamples / sampleRate;
+    float const blockLoad = (float)(elapsed / deadline);
+
+    float const alpha =
+      (float)jmin(1.0, deadline / jmax(1.0e-3, (double)smoothingSeconds));
+    smoothedLoad += alpha * (blockLoad - smoothedLoad);
+    load.store(smoothedLoad, std::memory_order_relaxed);
+
+    int const holdSamples = (int)(holdSeconds * sampleRate);
+    // clamped, so that it does not overflow while the order is stable
+    samplesSinceStep = jmin(samplesSinceStep + numSamples, holdSamples);
+    if (samplesSinceStep < holdSamples) {
+      return;
+    }
+
+    int const order = targetOrder.load(std::memory_order_relaxed);
+    int const upperBound = jmin(maxOrder.load(), parameterOrder.load());
+    int const lowerBound = jmin(minOrder.load(), upperBound);
+
+    int newOrder = jlimit(lowerBound, upperBound, order);
+    if (smoothedLoad > highLoad && newOrder > lowerBound) {
+      --newOrder;
+    }
+    else if (smoothedLoad < lowLoad && newOrder < upperBound) {
+      ++newOrder;
+    }
+
+    if (newOrder != order) {
+      targetOrder.store(newOrder, std::memory_order_relaxed);
+      samplesSinceStep = 0;
+    }
+  }
+
+private:
+  void timerCallback() override
+  {
+    int const order = attachments.getParameterOrder();
+    parameterOrder = order;
+
+    if (!isEnabled) {
+      targetOrder = order;
+      if (effectiveOrder != order) {
+        attachments.setOrderOverride(-1);
+        effectiveOrder = order;
+      }
+      return;
+    }
+
+    int const upperBound = jmin(maxOrder.load(), order);
+    int const target =
+      jlimit(jmin(minOrder.load(), upperBound), upperBound, targetOrder.load());
+    if (target != effectiveOrder.load()) {
+      attachments.setOrderOverride(target);
+      effectiveOrder = target;
+    }
+  }
+
+  OversamplingAttachments<Scalar>& attachments;
+
+  std::atomic<bool> isEnabled{ true };
+  std::atomic<int> minOrder{ 0 };
+  std::atomic<int> maxOrder{ 5 };
+  std::atomic<int> parameterOrder{ 5 };
+  std::atomic<int> targetOrder{ 5 };
+  std::atomic<int> effectiveOrder{ -1 };
+  std::atomic<float> load{ 0.f };
+
+  // used only by the audio thread
+  double sampleRate = 48000.0;
+  int64 blockStart = 0;
+  float smoothedLoad = 0.f;
+  int samplesSinceStep = 0;
+};
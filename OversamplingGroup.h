@@ -0,0 +1,318 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "OversamplingParameters.h"
+#include <JuceHeader.h>
+#include <list>
+#include <vector>
+
+/**
+ * The class OversamplingGroup keeps one oversimple::Oversampling instance for
+ * each band of a multiband processor. Each band can have its own
+ * OversamplingParameters, or follow the global ones.
+ * When any parameter changes, a new batch of instances is built on a
+ * background thread. The bands whose order and phase mode did not change keep
+ * their instance, which is shared by the old and the new batch, while the
+ * others reuse a cached instance if there is one for their order and phase
+ * mode, see OversamplingCache. The batch is handed to the audio thread as a
+ * whole with a RealtimeSwap, so all the bands always switch in the same block.
+ * An instance goes back to the cache only when no batch refers to it anymore.
+ * The audio thread must call update at the start of each block, and then get
+ * the instance of each band with getOversampling.
+ */
+template<typename Scalar>
+class OversamplingGroup : private Thread
+{
+public:
+  using Oversampling = oversimple::Oversampling<Scalar>;
+  using Instance = OversamplingInstance<Scalar>;
+
+  /**
+   * @param globalParameters the parameters followed by the bands that do not
+   * have their own
+   * @param bandSettings the settings of each band, of which the order and the
+   * phase mode are overwritten by those of the parameters
+   * @param bandParameters the parameters of each band, or nullptr for the bands
+   * that follow the global parameters. If empty, all the bands follow the
+   * global parameters.
+   * @param maxNumCachedInstancesPerBand see OversamplingCache
+   */
+  OversamplingGroup(OversamplingParameters& globalParameters,
+                    AudioProcessorValueTreeState& apvts,
+                    std::vector<oversimple::OversamplingSettings> bandSettings,
+                    std::vector<OversamplingParameters*> bandParameters = {},
+                    int maxNumCachedInstancesPerBand = 2)
+    : Thread("Oversampling Group Builder")
+    , numBands((int)bandSettings.size())
+  {
+    bandParameters.resize(numBands, nullptr);
+
+    for (int band = 0; band < numBands; ++band) {
+      bands.push_back({ bandSettings[band], bandParameters[band] != nullptr });
+      caches.emplace_back(maxNumCachedInstancesPerBand);
+      liveInstances.emplace_back();
+    }
+
+    attach(globalParameters, apvts, -1);
+    for (int band = 0; band < numBands; ++band) {
+      if (bandParameters[band]) {
+        attach(*bandParameters[band], apvts, band);
+      }
+    }
+    isAttached = true;
+
+    build();
+
+    startThread();
+  }
+
+  ~OversamplingGroup() override
+  {
+    attachments.clear();
+    stopThread(-1);
+  }
+
+  int getNumBands() const { return numBands; }
+
+  /**
+   * Changes the settings of all the bands, other than the order and the phase
+   * mode, and builds the new instances on the calling thread, see
+   * OversamplingAttachments::setSettings.
+   */
+  void setSettings(std::vector<oversimple::OversamplingSettings> bandSettings)
+  {
+    jassert((int)bandSettings.size() == numBands);
+    {
+      const ScopedLock lock(settingsMutex);
+      for (int band = 0; band < numBands; ++band) {
+        auto& settings = bands[band].settings;
+        bandSettings[band].order = settings.order;
+        bandSettings[band].linearPhase = settings.linearPhase;
+        settings = bandSettings[band];
+      }
+      ++settingsGeneration;
+    }
+    build();
+  }
+
+  /**
+   * Adopts the last batch of instances, if any. To be called by the audio
+   * thread at the start of each block. Returns true if the instances changed.
+   */
+  bool update() { return instances.update(); }
+
+  /**
+   * Returns the instance of a band. To be called by the audio thread, after
+   * update.
+   */
+  Oversampling* getOversampling(int band)
+  {
+    auto* const batch = instances.get();
+    return batch ? &(*batch)[band]->oversampling : nullptr;
+  }
+
+  int getOversamplingOrder(int band)
+  {
+    auto* const batch = instances.get();
+    return batch ? (*batch)[band]->order : 0;
+  }
+
+private:
+  // the instances are owned by liveInstances, and can be shared by batches
+  using Batch = std::vector<Instance*>;
+
+  struct LiveInstance
+  {
+    std::unique_ptr<Instance> instance;
+    int numBatches;
+  };
+
+  struct Band
+  {
+    oversimple::OversamplingSettings settings;
+    bool hasOwnParameters;
+  };
+
+  struct ParameterAttachments
+  {
+    std::unique_ptr<FloatAttachment> order;
+    std::unique_ptr<BoolAttachment> linearPhase;
+  };
+
+  // band is -1 for the global parameters
+  void attach(OversamplingParameters& parameters,
+              AudioProcessorValueTreeState& apvts,
+              int band)
+  {
+    attachments.emplace_back();
+    auto* const attached = &attachments.back();
+
+    auto const onChange = [this, attached, band]() {
+      if (!attached->order || !attached->linearPhase) {
+        return;
+      }
+      {
+        const ScopedLock lock(settingsMutex);
+        for (int b = 0; b < numBands; ++b) {
+          if (b == band || (band < 0 && !bands[b].hasOwnParameters)) {
+            bands[b].settings.order = (int)attached->order->getValue();
+            bands[b].settings.linearPhase = attached->linearPhase->getValue();
+          }
+        }
+      }
+      if (isAttached) {
+        requestBuild();
+      }
+    };
+
+    attached->linearPhase = std::make_unique<BoolAttachment>(
+      apvts, parameters.linearPhase.getID(), onChange);
+    attached->order = std::make_unique<FloatAttachment>(
+      apvts,
+      parameters.order->paramID,
+      onChange,
+      NormalisableRange<float>(0.f, 5.f, 1.f));
+    onChange();
+  }
+
+  void requestBuild()
+  {
+    ++requestedBuild;
+    notify();
+  }
+
+  void build()
+  {
+    const ScopedLock lock(buildMutex);
+    std::vector<oversimple::OversamplingSettings> batchSettings;
+    batchSettings.reserve(numBands);
+    uint32_t generation;
+    {
+      const ScopedLock settingsLock(settingsMutex);
+      for (auto& band : bands) {
+        batchSettings.push_back(band.settings);
+      }
+      generation = settingsGeneration;
+    }
+    if (generation != cachedGeneration) {
+      for (auto& cache : caches) {
+        cache.clear();
+      }
+      cachedGeneration = generation;
+    }
+
+    auto batch = std::make_unique<Batch>(numBands, nullptr);
+    bool hasChanged = latestBatch.empty();
+    for (int band = 0; band < numBands; ++band) {
+      auto const& settings = batchSettings[band];
+      Instance* instance = latestBatch.empty() ? nullptr : latestBatch[band];
+      if (!instance || instance->order != settings.order ||
+          instance->linearPhase != settings.linearPhase ||
+          instance->settingsGeneration != generation) {
+        auto owned =
+          caches[band].take(settings.order, settings.linearPhase, generation);
+        if (!owned) {
+          owned = std::make_unique<Instance>(settings, generation);
+        }
+        instance = owned.get();
+        liveInstances[band].push_back({ std::move(owned), 0 });
+        hasChanged = true;
+      }
+      (*batch)[band] = instance;
+    }
+    if (!hasChanged) {
+      return;
+    }
+    for (int band = 0; band < numBands; ++band) {
+      auto* const live = findLiveInstance(band, (*batch)[band]);
+      jassert(live != nullptr);
+      if (live) {
+        ++live->numBatches;
+      }
+    }
+    latestBatch = *batch;
+
+    recycle(instances.publish(std::move(batch)));
+    recycle(instances.takeRetired());
+  }
+
+  LiveInstance* findLiveInstance(int band, Instance* instance)
+  {
+    for (auto& live : liveInstances[band]) {
+      if (live.instance.get() == instance) {
+        return &live;
+      }
+    }
+    return nullptr;
+  }
+
+  // puts back into the caches the instances of a batch that are not used by
+  // any other batch
+  void recycle(std::unique_ptr<Batch> batch)
+  {
+    if (!batch) {
+      return;
+    }
+    for (int band = 0; band < numBands; ++band) {
+      auto& live = liveInstances[band];
+      for (auto it = live.begin(); it != live.end(); ++it) {
+        if (it->instance.get() == (*batch)[band]) {
+          if (--it->numBatches == 0) {
+            caches[band].put(std::move(it->instance), cachedGeneration);
+            live.erase(it);
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  void run() override
+  {
+    int lastBuild = requestedBuild.load();
+    while (!threadShouldExit()) {
+      wait(100);
+      {
+        const ScopedLock lock(buildMutex);
+        recycle(instances.takeRetired());
+      }
+      int const request = requestedBuild.load();
+      if (request != lastBuild) {
+        lastBuild = request;
+        build();
+      }
+    }
+  }
+
+  int const numBands;
+  // a list, so that the callbacks can hold pointers to its elements
+  std::list<ParameterAttachments> attachments;
+  bool isAttached = false;
+  CriticalSection settingsMutex;
+  CriticalSection buildMutex;
+  std::vector<Band> bands;
+  uint32_t settingsGeneration = 0;
+  std::atomic<int> requestedBuild{ 0 };
+  // the caches, cachedGeneration, liveInstances and latestBatch are guarded by
+  // buildMutex
+  std::vector<OversamplingCache<Scalar>> caches;
+  uint32_t cachedGeneration = 0;
+  std::vector<std::vector<LiveInstance>> liveInstances;
+  Batch latestBatch;
+  RealtimeSwap<Batch> instances;
+};
@@ -17,6 +17,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
 #include "Attachments.h"
+#include "OversamplingCache.h"
+#include "RealtimeSwap.h"
 #include "WrappedBoolParameter.h"
 #include "oversimple/Oversampling.hpp"
 
@@ -30,70 +32,269 @@ struct OversamplingParameters
   WrappedBoolParameter linearPhase;
 };
 
-template<typename Scalar, class Mutex>
-class OversamplingAttachments
+/**
+ * The class OversamplingAttachments keeps an oversimple::Oversampling instance
+ * in sync with an OversamplingParameters. When the order or the linear phase
+ * parameter changes, the new instance is built on a background thread and
+ * handed to the audio thread with a RealtimeSwap, so processing is never
+ * suspended, and the audio thread never waits for a lock.
+ * The audio thread must call getOversampling at the start of each block, and
+ * use the returned instance for the whole block. The replaced instances are
+ * destroyed by the background thread, or, if enabled with
+ * setMaxNumCachedInstances, reset and kept in an OversamplingCache, so that
+ * switching back to an order and phase mode used before costs only a pointer
+ * swap.
+ */
+template<typename Scalar>
+class OversamplingAttachments : private Thread
 {
-  std::unique_ptr<FloatAttachment> orderAttachment;
-  std::unique_ptr<BoolAttachment> linearPhaseAttachment;
-
 public:
-  OversamplingAttachments(
-    OversamplingParameters& parameters,
-    AudioProcessorValueTreeState& apvts,
-    AudioProcessor* processor,
-    std::unique_ptr<oversimple::Oversampling<Scalar>>* oversampling,
-    oversimple::OversamplingSettings* oversamplingSettings,
-    Mutex* oversamplingMutex)
+  using Oversampling = oversimple::Oversampling<Scalar>;
+  using Instance = OversamplingInstance<Scalar>;
+
+  /**
+   * @param maxNumCachedInstances the maximum number of instances to keep for
+   * the orders and phase modes not in use, see OversamplingCache. 0 disables
+   * the cache.
+   */
+  OversamplingAttachments(OversamplingParameters& parameters,
+                          AudioProcessorValueTreeState& apvts,
+                          oversimple::OversamplingSettings settings,
+                          int maxNumCachedInstances = 0)
+    : Thread("Oversampling Builder")
+    , settings(settings)
+    , cache(maxNumCachedInstances)
   {
     linearPhaseAttachment = std::make_unique<BoolAttachment>(
-      apvts,
-      parameters.linearPhase.getID(),
-      [this,
-       processor,
-       oversampling,
-       oversamplingSettings,
-       oversamplingMutex]() {
+      apvts, parameters.linearPhase.getID(), [this]() {
         if (!linearPhaseAttachment) {
           return;
         }
-
-        auto const guard =
-          std::lock_guard<std::recursive_mutex>(*oversamplingMutex);
-
-        processor->suspendProcessing(true);
-
-        oversamplingSettings->linearPhase = linearPhaseAttachment->getValue();
-
-        *oversampling = std::make_unique<oversimple::Oversampling<Scalar>>(
-          *oversamplingSettings);
-
-        processor->suspendProcessing(false);
+        {
+          const ScopedLock lock(settingsMutex);
+          this->settings.linearPhase = linearPhaseAttachment->getValue();
+        }
+        requestBuild();
       });
 
     orderAttachment = std::make_unique<FloatAttachment>(
       apvts,
       parameters.order->paramID,
-      [this,
-       processor,
-       oversampling,
-       oversamplingSettings,
-       oversamplingMutex]() {
+      [this]() {
         if (!orderAttachment) {
           return;
         }
+        {
+          const ScopedLock lock(settingsMutex);
+          parameterOrder = (int)orderAttachment->getValue();
+          updateOrder();
+        }
+        requestBuild();
+      },
+      NormalisableRange<float>(0.f, 5.f, 1.f));
 
-        auto const guard =
-          std::lock_guard<std::recursive_mutex>(*oversamplingMutex);
+    {
+      const ScopedLock lock(settingsMutex);
+      this->settings.linearPhase = linearPhaseAttachment->getValue();
+      parameterOrder = (int)orderAttachment->getValue();
+      updateOrder();
+    }
+    build();
 
-        processor->suspendProcessing(true);
+    startThread();
+  }
 
-        oversamplingSettings->order = (int)orderAttachment->getValue();
+  ~OversamplingAttachments() override
+  {
+    orderAttachment.reset();
+    linearPhaseAttachment.reset();
+    // a build cannot be interrupted, so wait for it rather than killing it
+    stopThread(-1);
+  }
 
-        *oversampling = std::make_unique<oversimple::Oversampling<Scalar>>(
-          *oversamplingSettings);
+  /**
+   * Changes the settings and builds a new instance on the calling thread, to
+   * be used from the next block. The order and the linear phase are always
+   * those of the parameters, or of setOrderOverride. To be called when the
+   * audio thread is not running, for example in prepareToPlay, when the new
+   * instance must be used right away.
+   */
+  void setSettings(oversimple::OversamplingSettings newSettings)
+  {
+    {
+      const ScopedLock lock(settingsMutex);
+      newSettings.order = settings.order;
+      newSettings.linearPhase = settings.linearPhase;
+      settings = newSettings;
+      ++settingsGeneration;
+    }
+    build();
+  }
 
-        processor->suspendProcessing(false);
-      },
-      NormalisableRange<float>(0.f, 5.f, 1.f));
+  /**
+   * Uses an order other than the one of the parameter, for example to lower
+   * the quality when the processor is running out of time, see
+   * OversamplingGovernor. A negative value restores the order of the
+   * parameter. Not to be called by the audio thread.
+   */
+  void setOrderOverride(int order)
+  {
+    {
+      const ScopedLock lock(settingsMutex);
+      orderOverride = order;
+      if (!updateOrder()) {
+        return;
+      }
+    }
+    requestBuild();
+  }
+
+  /**
+   * Returns the order set by the parameter, regardless of any override.
+   */
+  int getParameterOrder() const
+  {
+    const ScopedLock lock(settingsMutex);
+    return parameterOrder;
+  }
+
+  void setMaxNumCachedInstances(int maxNumCachedInstances)
+  {
+    const ScopedLock lock(buildMutex);
+    cache.setMaxNumInstances(maxNumCachedInstances);
+  }
+
+  oversimple::OversamplingSettings getSettings() const
+  {
+    const ScopedLock lock(settingsMutex);
+    return settings;
   }
-};
\ No newline at end of file
+
+  /**
+   * Returns the instance to use for the current block. To be called by the
+   * audio thread at the start of each block.
+   */
+  Oversampling* getOversampling()
+  {
+    instance.update(keepPreviousInstance.load(std::memory_order_relaxed));
+    auto* const active = instance.get();
+    return active ? &active->oversampling : nullptr;
+  }
+
+  /**
+   * Returns the order of the instance returned by the last call to
+   * getOversampling. To be called by the audio thread.
+   */
+  int getOversamplingOrder() const
+  {
+    auto* const active = instance.get();
+    return active ? active->order : 0;
+  }
+
+  /**
+   * If set, when getOversampling adopts a new instance the previous one stays
+   * available with getPreviousOversampling, so that the audio thread can
+   * crossfade between them, see OversamplingCrossfade.
+   */
+  void setKeepPreviousOversampling(bool keepPrevious)
+  {
+    keepPreviousInstance = keepPrevious;
+  }
+
+  /**
+   * Returns the instance replaced by the last call to getOversampling, if it
+   * has not been released yet. To be called by the audio thread.
+   */
+  Oversampling* getPreviousOversampling()
+  {
+    auto* const previous = instance.getPrevious();
+    return previous ? &previous->oversampling : nullptr;
+  }
+
+  /**
+   * Hands the instance returned by getPreviousOversampling back to the
+   * background thread. To be called by the audio thread when the transition
+   * from it is over.
+   */
+  void releasePreviousOversampling() { instance.releasePrevious(); }
+
+private:
+  // returns true if the order changed, to be called holding settingsMutex
+  bool updateOrder()
+  {
+    // the parameter is always the ceiling, even for a stale override
+    int const order = orderOverride >= 0 ? jmin(orderOverride, parameterOrder)
+                                         : parameterOrder;
+    if (order == settings.order) {
+      return false;
+    }
+    settings.order = order;
+    return true;
+  }
+
+  void requestBuild()
+  {
+    ++requestedBuild;
+    notify();
+  }
+
+  void build()
+  {
+    // builds are serialized, so an older instance never replaces a newer one
+    const ScopedLock lock(buildMutex);
+    oversimple::OversamplingSettings buildSettings;
+    uint32_t generation;
+    {
+      const ScopedLock settingsLock(settingsMutex);
+      buildSettings = settings;
+      generation = settingsGeneration;
+    }
+    if (generation != cachedGeneration) {
+      cache.clear();
+      cachedGeneration = generation;
+    }
+    auto next =
+      cache.take(buildSettings.order, buildSettings.linearPhase, generation);
+    if (!next) {
+      next = std::make_unique<Instance>(buildSettings, generation);
+    }
+    // an instance that was never adopted goes back to the cache
+    cache.put(instance.publish(std::move(next)), generation);
+    cache.put(instance.takeRetired(), generation);
+  }
+
+  void collectRetired()
+  {
+    const ScopedLock lock(buildMutex);
+    cache.put(instance.takeRetired(), cachedGeneration);
+  }
+
+  void run() override
+  {
+    int lastBuild = requestedBuild.load();
+    while (!threadShouldExit()) {
+      wait(100);
+      collectRetired();
+      int const request = requestedBuild.load();
+      if (request != lastBuild) {
+        lastBuild = request;
+        build();
+      }
+    }
+  }
+
+  std::unique_ptr<FloatAttachment> orderAttachment;
+  std::unique_ptr<BoolAttachment> linearPhaseAttachment;
+  CriticalSection mutable settingsMutex;
+  CriticalSection buildMutex;
+  oversimple::OversamplingSettings settings;
+  uint32_t settingsGeneration = 0;
+  int parameterOrder = 0;
+  int orderOverride = -1;
+  std::atomic<int> requestedBuild{ 0 };
+  std::atomic<bool> keepPreviousInstance{ false };
+  // the cache and cachedGeneration are guarded by buildMutex
+  OversamplingCache<Scalar> cache;
+  uint32_t cachedGeneration = 0;
+  RealtimeSwap<Instance> instance;
+};
@@ -0,0 +1,178 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "BitMask.h"
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * The class ParameterChangeSet keeps track of which parameters of an
+ * AudioProcessor changed since the audio thread last looked, so that the
+ * processing code can update only what depends on them, instead of polling all
+ * the parameters every block.
+ * The parameters are identified by their index in the AudioProcessor, see
+ * AudioProcessorParameter::getParameterIndex. When a parameter changes, from
+ * any thread, its bit is set in a bitset of atomic 64 bit words, and the bit of
+ * its word is set in a summary word. Once per block the audio thread calls
+ * ParameterChangeSet::collect, which exchanges with zero only the words marked
+ * in the summary, so its cost depends on how many parameters changed, not on
+ * how many there are. Nothing is allocated and no lock is taken after
+ * construction.
+ * Each consumer must have its own ParameterChangeSet, as collecting clears the
+ * changes. SplineParameters::updateSpline can take the changes, to read only
+ * the knots that changed.
+ */
+class ParameterChangeSet : private AudioProcessorParameter::Listener
+{
+public:
+  /**
+   * The parameters that changed between two calls to collect.
+   */
+  class Changes
+  {
+  public:
+    bool isEmpty() const { return summary == 0; }
+
+    bool contains(int parameterIndex) const
+    {
+      return (words[parameterIndex >> 6] >> (parameterIndex & 63)) & 1;
+    }
+
+    bool contains(AudioProcessorParameter const* parameter) const
+    {
+      return contains(parameter->getParameterIndex());
+    }
+
+    /**
+     * Calls a functor with the index of each parameter that changed.
+     */
+    template<class Functor>
+    void forEach(Functor&& functor) const
+    {
+      bitMask::forEachSetBit(summary, [&](int summaryBit) {
+        for (int w = summaryBit; w < (int)words.size(); w += 64) {
+          uint64_t const word = words[w];
+          bitMask::forEachSetBit(
+            word, [&](int bit) { functor(64 * w + bit); });
+        }
+      });
+    }
+
+  private:
+    friend class ParameterChangeSet;
+    std::vector<uint64_t> words;
+    uint64_t summary = 0;
+  };
+
+  /**
+   * @param processor the AudioProcessor whose parameters are tracked
+   * @param startWithAllChanged if true, the first call to collect reports all
+   * the parameters as changed, so that the consumer can initialize everything
+   * from the changes
+   */
+  explicit ParameterChangeSet(AudioProcessor& processor,
+                              bool startWithAllChanged = true)
+    : parameters(processor.getParameters())
+    , numWords((parameters.size() + 63) / 64)
+    , words(new std::atomic<uint64_t>[(size_t)jmax(1, numWords)])
+  {
+    for (int w = 0; w < numWords; ++w) {
+      words[w].store(0, std::memory_order_relaxed);
+    }
+    changes.words.resize((size_t)numWords, 0);
+
+    for (auto* parameter : parameters) {
+      parameter->addListener(this);
+    }
+
+    if (startWithAllChanged) {
+      markAllAsChanged();
+    }
+  }
+
+  ~ParameterChangeSet() override
+  {
+    for (auto* parameter : parameters) {
+      parameter->removeListener(this);
+    }
+  }
+
+  /**
+   * Marks a parameter as changed. Thread safe and lock-free.
+   */
+  void markAsChanged(int parameterIndex)
+  {
+    jassert(parameterIndex >= 0 && parameterIndex < parameters.size());
+    int const w = parameterIndex >> 6;
+    // the word is marked before the summary, so the change is seen at most one
+    // block late if the audio thread collects in between
+    words[w].fetch_or(bitMask::bit(parameterIndex & 63),
+                      std::memory_order_release);
+    summary.fetch_or(bitMask::bit(w & 63), std::memory_order_release);
+  }
+
+  /**
+   * Marks all the parameters as changed, for example after prepareToPlay.
+   */
+  void markAllAsChanged()
+  {
+    for (int i = 0; i < parameters.size(); ++i) {
+      markAsChanged(i);
+    }
+  }
+
+  /**
+   * Takes all the changes since the last call and clears them. To be called
+   * once per block by the audio thread. The returned Changes are valid until
+   * the next call.
+   */
+  Changes const& collect()
+  {
+    // only the words collected last time can be non-zero
+    bitMask::forEachSetBit(changes.summary, [&](int summaryBit) {
+      for (int w = summaryBit; w < numWords; w += 64) {
+        changes.words[w] = 0;
+      }
+    });
+    changes.summary = summary.exchange(0, std::memory_order_acquire);
+    bitMask::forEachSetBit(changes.summary, [&](int summaryBit) {
+      for (int w = summaryBit; w < numWords; w += 64) {
+        changes.words[w] = words[w].exchange(0, std::memory_order_acquire);
+      }
+    });
+    return changes;
+  }
+
+private:
+  void parameterValueChanged(int parameterIndex, float) override
+  {
+    markAsChanged(parameterIndex);
+  }
+
+  void parameterGestureChanged(int, bool) override {}
+
+  Array<AudioProcessorParameter*> parameters;
+  int numWords;
+  std::unique_ptr<std::atomic<uint64_t>[]> words;
+  std::atomic<uint64_t> summary{ 0 };
+  Changes changes;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterChangeSet)
+};
@@ -0,0 +1,118 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "ParameterRegistry.h"
+#include <JuceHeader.h>
+#include <atomic>
+#include <cmath>
+#include <type_traits>
+
+/**
+ * The truth test of the parameters read as bools, shared by ParameterHandle
+ * and WrappedBoolParameter: a value is true if its magnitude is above a
+ * threshold that depends only on the kind of parameter. As with
+ * AudioParameterBool::get, a bool parameter is true if its value is at least
+ * 0.5, while a float parameter used as a bool is true if its value is not 0.
+ * The values are the denormalised ones, which for bool parameters are the same
+ * as the normalised ones.
+ */
+inline float
+getBoolParameterThreshold(RangedAudioParameter const* parameter)
+{
+  return dynamic_cast<AudioParameterBool const*>(parameter) != nullptr
+           ? std::nextafter(0.5f, 0.f)
+           : 0.f;
+}
+
+inline bool
+isBoolParameterValueTrue(float value, float threshold)
+{
+  return std::abs(value) > threshold;
+}
+
+/**
+ * The class ParameterHandle reads the value of a parameter of an
+ * AudioProcessorValueTreeState from its raw atomic value, as the type given as
+ * template argument: float for float parameters, bool for bool parameters, or
+ * for float parameters used as bools, and int for choice and int parameters.
+ * The conversion is chosen at compile time, so reading a value is an atomic
+ * load and at most a comparison, with no branches on the kind of parameter and
+ * no virtual calls. Bool handles compare against the threshold of their
+ * parameter, see isBoolParameterValueTrue, so they agree with
+ * WrappedBoolParameter::getValue. A handle is cheap to copy and to store.
+ */
+template<typename Type>
+class ParameterHandle
+{
+  static_assert(std::is_same_v<Type, float> || std::is_same_v<Type, bool> ||
+                  std::is_same_v<Type, int>,
+                "ParameterHandle supports float, bool and int.");
+
+public:
+  ParameterHandle() = default;
+
+  /**
+   * @param threshold used only by bool handles, see getBoolParameterThreshold
+   */
+  explicit ParameterHandle(std::atomic<float>* rawValue, float threshold = 0.f)
+    : rawValue(rawValue)
+    , threshold(threshold)
+  {}
+
+  Type get() const
+  {
+    float const value = rawValue->load(std::memory_order_relaxed);
+    if constexpr (std::is_same_v<Type, bool>) {
+      return isBoolParameterValueTrue(value, threshold);
+    }
+    else if constexpr (std::is_same_v<Type, int>) {
+      return roundToInt(value);
+    }
+    else {
+      return value;
+    }
+  }
+
+  bool isValid() const { return rawValue != nullptr; }
+
+  std::atomic<float>* getRawValue() const { return rawValue; }
+
+private:
+  std::atomic<float>* rawValue = nullptr;
+  float threshold = 0.f;
+};
+
+using FloatParameterHandle = ParameterHandle<float>;
+using BoolParameterHandle = ParameterHandle<bool>;
+using ChoiceParameterHandle = ParameterHandle<int>;
+
+template<typename Type>
+ParameterHandle<Type>
+makeParameterHandle(AudioProcessorValueTreeState& apvts, String const& paramID)
+{
+  auto const registry = ParameterRegistry::getFor(apvts);
+  auto* const rawValue = registry->getRawParameterValue(paramID);
+  jassert(rawValue != nullptr);
+  if constexpr (std::is_same_v<Type, bool>) {
+    return ParameterHandle<Type>(
+      rawValue, getBoolParameterThreshold(registry->getParameter(paramID)));
+  }
+  else {
+    return ParameterHandle<Type>(rawValue);
+  }
+}
@@ -0,0 +1,96 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "SharedStateObject.h"
+#include <JuceHeader.h>
+#include <vector>
+
+/**
+ * The class ParameterRegistry maps the IDs of the parameters of an
+ * AudioProcessorValueTreeState to indices, through a hash table, and holds the
+ * parameters and their raw values by index. It lets the classes of this
+ * library look up a parameter by its ID in constant time, instead of through
+ * the string-keyed lookups of AudioProcessorValueTreeState.
+ * The registry is built from the parameters of the AudioProcessor when it is
+ * created, so it must be created after all the parameters have been added to
+ * the AudioProcessorValueTreeState. There is one registry for each
+ * AudioProcessorValueTreeState, see ParameterRegistry::getFor.
+ */
+class ParameterRegistry
+{
+public:
+  explicit ParameterRegistry(AudioProcessorValueTreeState& state)
+    : indices(2 * jmax(1, state.processor.getParameters().size()))
+  {
+    for (auto* processorParameter : state.processor.getParameters()) {
+      auto* parameter = dynamic_cast<RangedAudioParameter*>(processorParameter);
+      if (!parameter || state.getParameter(parameter->paramID) != parameter) {
+        continue;
+      }
+      indices.set(parameter->paramID, (int)parameters.size());
+      parameters.push_back(parameter);
+      rawValues.push_back(state.getRawParameterValue(parameter->paramID));
+    }
+  }
+
+  static std::shared_ptr<ParameterRegistry> getFor(
+    AudioProcessorValueTreeState& state)
+  {
+    return getSharedObjectForState<ParameterRegistry>(state);
+  }
+
+  /**
+   * Returns the index of a parameter, or -1 if the AudioProcessorValueTreeState
+   * has no parameter with that ID.
+   */
+  int getIndex(String const& paramID) const
+  {
+    return indices.contains(paramID) ? indices[paramID] : -1;
+  }
+
+  int getNumParameters() const { return (int)parameters.size(); }
+
+  RangedAudioParameter* getParameter(int index) const
+  {
+    return parameters[index];
+  }
+
+  std::atomic<float>* getRawParameterValue(int index) const
+  {
+    return rawValues[index];
+  }
+
+  RangedAudioParameter* getParameter(String const& paramID) const
+  {
+    int const index = getIndex(paramID);
+    return index >= 0 ? parameters[index] : nullptr;
+  }
+
+  std::atomic<float>* getRawParameterValue(String const& paramID) const
+  {
+    int const index = getIndex(paramID);
+    return index >= 0 ? rawValues[index] : nullptr;
+  }
+
+private:
+  HashMap<String, int> indices;
+  std::vector<RangedAudioParameter*> parameters;
+  std::vector<std::atomic<float>*> rawValues;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterRegistry)
+};
@@ -0,0 +1,144 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+
+/**
+ * The class RealtimeSwap hands objects built on other threads to the audio
+ * thread, read-copy-update style, without locks and without the audio thread
+ * ever allocating or freeing memory.
+ * A new object is published to a pending slot with RealtimeSwap::publish. At
+ * the start of each block the audio thread calls RealtimeSwap::update, which
+ * adopts the pending object, if any, and moves the one it was using to a
+ * retired slot. The retired object is taken back, and destroyed or reused, by
+ * another thread with RealtimeSwap::takeRetired. Until that happens the audio
+ * thread does not adopt further objects, so nothing is ever freed by it.
+ * The audio thread can also keep using the previous object for a while after
+ * adopting a new one, for example to crossfade between them, see
+ * RealtimeSwap::update and RealtimeSwap::releasePrevious.
+ */
+template<class T>
+class RealtimeSwap
+{
+public:
+  RealtimeSwap() = default;
+
+  ~RealtimeSwap()
+  {
+    delete pending.load();
+    delete retired.load();
+    delete previous;
+    delete active;
+  }
+
+  /**
+   * Publishes an object for the audio thread. If the previously published one
+   * has not been adopted yet it is returned, as the audio thread will never see
+   * it. Not to be called by the audio thread.
+   */
+  std::unique_ptr<T> publish(std::unique_ptr<T> object)
+  {
+    return std::unique_ptr<T>(
+      pending.exchange(object.release(), std::memory_order_acq_rel));
+  }
+
+  /**
+   * Takes back the object the audio thread stopped using, if any. Not to be
+   * called by the audio thread.
+   */
+  std::unique_ptr<T> takeRetired()
+  {
+    return std::unique_ptr<T>(
+      retired.exchange(nullptr, std::memory_order_acquire));
+  }
+
+  /**
+   * Returns true if there is an object waiting to be adopted by the audio
+   * thread.
+   */
+  bool isPending() const
+  {
+    return pending.load(std::memory_order_acquire) != nullptr;
+  }
+
+  /**
+   * Adopts the last published object, if any. To be called by the audio thread
+   * at the start of a block. Returns true if the object in use changed.
+   * @param keepPrevious if true, the object that was in use is not retired,
+   * and it is available with getPrevious until releasePrevious is called. No
+   * other object is adopted in the meantime.
+   */
+  bool update(bool keepPrevious = false)
+  {
+    if (previous || pending.load(std::memory_order_relaxed) == nullptr) {
+      return false;
+    }
+    // only the audio thread fills the retired slot
+    if (retired.load(std::memory_order_acquire) != nullptr) {
+      return false;
+    }
+    T* const next = pending.exchange(nullptr, std::memory_order_acq_rel);
+    if (!next) {
+      return false;
+    }
+    if (keepPrevious && active) {
+      previous = active;
+    }
+    else {
+      retired.store(active, std::memory_order_release);
+    }
+    active = next;
+    return true;
+  }
+
+  /**
+   * Returns the object replaced by the last update called with keepPrevious,
+   * or nullptr if it was released. To be called by the audio thread.
+   */
+  T* getPrevious() const { return previous; }
+
+  /**
+   * Retires the object returned by getPrevious. To be called by the audio
+   * thread.
+   */
+  void releasePrevious()
+  {
+    if (previous) {
+      // the retired slot stays empty while there is a previous object
+      jassert(retired.load(std::memory_order_relaxed) == nullptr);
+      retired.store(previous, std::memory_order_release);
+      previous = nullptr;
+    }
+  }
+
+  /**
+   * Returns the object in use by the audio thread.
+   */
+  T* get() const { return active; }
+
+private:
+  std::atomic<T*> pending{ nullptr };
+  std::atomic<T*> retired{ nullptr };
+  T* active = nullptr;
+  T* previous = nullptr;
+
+  RealtimeSwap(RealtimeSwap const&) = delete;
+  RealtimeSwap& operator=(RealtimeSwap const&) = delete;
+};
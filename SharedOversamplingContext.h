@@ -0,0 +1,142 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "OversamplingParameters.h"
+#include <JuceHeader.h>
+#include <vector>
+
+/**
+ * A processing stage that runs at the oversampled rate inside a
+ * SharedOversamplingContext.
+ */
+template<typename Scalar>
+class OversampledStage
+{
+public:
+  virtual ~OversampledStage() = default;
+
+  /**
+   * Called on the audio thread when the oversampling order changes, before the
+   * first block processed at the new rate. It must not allocate memory.
+   */
+  virtual void oversamplingChanged(double oversampledRate) {}
+
+  virtual void process(Scalar* const* io, int numChannels, int numSamples) = 0;
+};
+
+/**
+ * The class SharedOversamplingContext runs a chain of nonlinear stages, such
+ * as waveshapers, saturators and clippers, at the oversampled rate, with a
+ * single upsampling before the first stage and a single downsampling after
+ * the last one, instead of one of each around every stage. The oversampling is
+ * configured by one OversamplingParameters, through the OversamplingAttachments
+ * owned by the context.
+ * The Resampler class adapts the oversimple::Oversampling interface, and it
+ * must provide:
+ * @code
+ * // upsamples the input and sets output to the planar upsampled buffers,
+ * // owned by the oversampling instance, returning the number of samples
+ * static int upsample(oversimple::Oversampling<Scalar>& oversampling,
+ *                     Scalar const* const* input,
+ *                     int numChannels,
+ *                     int numSamples,
+ *                     Scalar* const*& output);
+ * // downsamples the upsampled buffers into the output
+ * static void downsample(oversimple::Oversampling<Scalar>& oversampling,
+ *                        Scalar* const* upsampled,
+ *                        int numUpsampledSamples,
+ *                        Scalar* const* output,
+ *                        int numChannels,
+ *                        int numSamples);
+ * @endcode
+ * The stages are not owned by the context, and they must be added before the
+ * processing starts.
+ */
+template<typename Scalar, class Resampler>
+class SharedOversamplingContext
+{
+public:
+  SharedOversamplingContext(OversamplingParameters& parameters,
+                            AudioProcessorValueTreeState& apvts,
+                            oversimple::OversamplingSettings settings,
+                            int maxNumCachedInstances = 0)
+    : attachments(parameters, apvts, settings, maxNumCachedInstances)
+  {}
+
+  void addStage(OversampledStage<Scalar>& stage)
+  {
+    stages.push_back(&stage);
+  }
+
+  /**
+   * Changes the settings other than the order and the phase mode, see
+   * OversamplingAttachments::setSettings. Also to be called in
+   * prepareToPlay, with the sample rate.
+   */
+  void prepareToPlay(oversimple::OversamplingSettings settings,
+                     double newSampleRate)
+  {
+    sampleRate = newSampleRate;
+    attachments.setSettings(settings);
+    lastOversampling = nullptr;
+  }
+
+  OversamplingAttachments<Scalar>& getAttachments() { return attachments; }
+
+  /**
+   * Upsamples the buffers, runs all the stages, and downsamples the result
+   * back into the buffers. To be called by the audio thread.
+   */
+  void process(Scalar* const* io, int numChannels, int numSamples)
+  {
+    auto* const oversampling = attachments.getOversampling();
+    if (!oversampling) {
+      return;
+    }
+
+    if (oversampling != lastOversampling) {
+      lastOversampling = oversampling;
+      double const oversampledRate =
+        sampleRate * (double)(1 << attachments.getOversamplingOrder());
+      for (auto* stage : stages) {
+        stage->oversamplingChanged(oversampledRate);
+      }
+    }
+
+    Scalar* const* upsampled = nullptr;
+    int const numUpsampledSamples = Resampler::upsample(
+      *oversampling, io, numChannels, numSamples, upsampled);
+
+    for (auto* stage : stages) {
+      stage->process(upsampled, numChannels, numUpsampledSamples);
+    }
+
+    Resampler::downsample(*oversampling,
+                          upsampled,
+                          numUpsampledSamples,
+                          io,
+                          numChannels,
+                          numSamples);
+  }
+
+private:
+  OversamplingAttachments<Scalar> attachments;
+  std::vector<OversampledStage<Scalar>*> stages;
+  oversimple::Oversampling<Scalar>* lastOversampling = nullptr;
+  double sampleRate = 48000.0;
+};
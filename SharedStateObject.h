@@ -0,0 +1,56 @@
+/*
+Copyright 2020 Dario Mambro
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <map>
+#include <memory>
+
+/**
+ * Returns the instance of the class T associated with an
+ * AudioProcessorValueTreeState, creating it with T(state) if there is none.
+ * The instance is shared by all the objects that ask for it, and it is
+ * destroyed when the last of them releases it. This is how the attachments of
+ * this library share the helpers that must be unique for each
+ * AudioProcessorValueTreeState.
+ */
+template<class T>
+std::shared_ptr<T>
+getSharedObjectForState(AudioProcessorValueTreeState& state)
+{
+  static CriticalSection mutex;
+  static std::map<AudioProcessorValueTreeState*, std::weak_ptr<T>> objects;
+
+  const ScopedLock lock(mutex);
+
+  for (auto it = objects.begin(); it != objects.end();) {
+    if (it->second.expired()) {
+      it = objects.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  auto& object = objects[&state];
+  auto shared = object.lock();
+  if (!shared) {
+    shared = std::make_shared<T>(state);
+    object = shared;
+  }
+  return shared;
+}
@@ -25,7 +25,9 @@ SplineEditor::SplineEditor(
   , spline(
       parameters,
       apvts,
-      [this]() { onSplineChange(); },
+      [this](SplineAttachments::Change const& change) {
+        onSplineChange(change);
+      },
       symmetryParameter)
   , rangeX(parameters.rangeX)
   , rangeY(parameters.rangeY)
@@ -127,9 +129,10 @@ SplineEditor::paint(Graphics& g)
 
   // vumeter
 
-  if (vuMeter[0] && vuMeter[1]) {
-    vuMeterBuffer[0][0] = vuMeter[0]->load();
-    vuMeterBuffer[0][1] = vuMeter[1]->load();
+  if (vuMeterBus) {
+    vuMeterBus->read(vuMeterSnapshot);
+    vuMeterBuffer[0][0] = vuMeterSnapshot[vuMeterBusIndices[0]];
+    vuMeterBuffer[0][1] = vuMeterSnapshot[vuMeterBusIndices[1]];
     float const x0 = std::round(xToPixel((float)vuMeterBuffer[0][0]));
     float const x1 = std::round(xToPixel((float)vuMeterBuffer[0][1]));
     splineDsp->processBlock(vuMeterBuffer, vuMeterBuffer, numKnots);
@@ -512,9 +515,18 @@ SplineEditor::setSelectedKnot(int knot)
 }
 
 void
-SplineEditor::onSplineChange()
+SplineEditor::onSplineChange(SplineAttachments::Change const& change)
 {
-  redrawCurvesFlag = true;
+  // the values of disabled knots do not affect the curves, only the drawing of
+  // the knots themselves
+  bool const affectsCurves =
+    change.symmetry || change.knotStates != 0 ||
+    (change.knotValues & spline.getEnabledKnots()) != 0;
+
+  if (affectsCurves) {
+    redrawCurvesFlag = true;
+  }
+
   repaint();
 }
 
@@ -595,43 +607,56 @@ SplineEditor::getKnotCoord(int knotIndex, int channel)
 SplineAttachments::SplineAttachments(
   SplineParameters& parameters,
   AudioProcessorValueTreeState& apvts,
-  std::function<void(void)> onChange,
+  std::function<void(Change const&)> onChange,
   LinkableParameter<WrappedBoolParameter>* symmetryParameter)
+  : onChange(std::move(onChange))
 {
+  // the knots are tracked in 64 bit masks, further knots are not attached
+  jassert(parameters.knots.size() <= maxNumKnots);
+  int const numKnots = jmin(maxNumKnots, (int)parameters.knots.size());
+
   auto const makeKnotAttachments =
-    [&](SplineParameters::LinkableKnotParameters knot, int channel) {
+    [&](SplineParameters::LinkableKnotParameters& knot,
+        int index,
+        int channel) {
+      auto const callback = KnotValueCallback{ this, index };
       return SplineAttachments::KnotAttachments{
-        FloatAttachment::make(apvts,
-                              knot.parameters[channel].x->paramID,
-                              onChange,
-                              parameters.rangeX),
-        FloatAttachment::make(apvts,
-                              knot.parameters[channel].y->paramID,
-                              onChange,
-                              parameters.rangeY),
-        FloatAttachment::make(apvts,
-                              knot.parameters[channel].t->paramID,
-                              onChange,
-                              parameters.rangeTan),
-        FloatAttachment::make(apvts,
-                              knot.parameters[channel].s->paramID,
-                              onChange,
-                              NormalisableRange<float>{ 0.f, 1.f, 0.01f })
+        makeFloatAttachment(apvts,
+                            knot.parameters[channel].x->paramID,
+                            callback,
+                            parameters.rangeX),
+        makeFloatAttachment(apvts,
+                            knot.parameters[channel].y->paramID,
+                            callback,
+                            parameters.rangeY),
+        makeFloatAttachment(apvts,
+                            knot.parameters[channel].t->paramID,
+                            callback,
+                            parameters.rangeTan),
+        makeFloatAttachment(apvts,
+                            knot.parameters[channel].s->paramID,
+                            callback,
+                            NormalisableRange<float>{ 0.f, 1.f, 0.01f })
       };
     };
 
-  for (auto& knot : parameters.knots) {
+  knots.reserve(numKnots);
+
+  for (int i = 0; i < numKnots; ++i) {
+    auto& knot = parameters.knots[i];
     knots.push_back(SplineAttachments::LinkableKnotAttachments{
       std::array<SplineAttachments::KnotAttachments, 2>{
-        { makeKnotAttachments(knot, 0), makeKnotAttachments(knot, 1) } },
-      BoolAttachment::make(apvts, knot.enabled.getID(), onChange),
-      BoolAttachment::make(apvts, knot.linked.getID(), onChange) });
+        { makeKnotAttachments(knot, i, 0), makeKnotAttachments(knot, i, 1) } },
+      makeBoolAttachment(
+        apvts, knot.enabled.getID(), KnotStateCallback{ this, i }),
+      makeBoolAttachment(
+        apvts, knot.linked.getID(), KnotStateCallback{ this, i }) });
   }
 
   if (symmetryParameter) {
     for (int c = 0; c < 2; ++c) {
-      symmetry[c] =
-        BoolAttachment::make(apvts, symmetryParameter->getID(c), onChange);
+      symmetry[c] = makeBoolAttachment(
+        apvts, symmetryParameter->getID(c), SymmetryCallback{ this });
     }
   }
 }
@@ -648,6 +673,49 @@ SplineAttachments::getNumActiveKnots()
   return numKnots;
 }
 
+uint64_t
+SplineAttachments::getEnabledKnots()
+{
+  uint64_t enabledKnots = 0;
+  for (int i = 0; i < (int)knots.size(); ++i) {
+    if (knots[i].enabled->getValue()) {
+      enabledKnots |= uint64_t(1) << i;
+    }
+  }
+  return enabledKnots;
+}
+
+void
+SplineAttachments::onKnotValueChange(int knot)
+{
+  pendingChange.knotValues |= uint64_t(1) << knot;
+  triggerAsyncUpdate();
+}
+
+void
+SplineAttachments::onKnotStateChange(int knot)
+{
+  pendingChange.knotStates |= uint64_t(1) << knot;
+  triggerAsyncUpdate();
+}
+
+void
+SplineAttachments::onSymmetryChange()
+{
+  pendingChange.symmetry = true;
+  triggerAsyncUpdate();
+}
+
+void
+SplineAttachments::handleAsyncUpdate()
+{
+  auto const change = pendingChange;
+  pendingChange = Change{};
+  if (onChange) {
+    onChange(change);
+  }
+}
+
 SplineKnotEditor::SplineKnotEditor(SplineParameters& parameters,
                                    AudioProcessorValueTreeState& apvts,
                                    String const& midSideParamID)
@@ -656,6 +724,30 @@ SplineKnotEditor::SplineKnotEditor(SplineParameters& parameters,
   , enabled(*this, apvts)
   , linked(*this, apvts)
   , channelLabels(apvts, midSideParamID, false)
+  , x(apvts,
+      xLabel,
+      parameters.knots[0].linked.getID(),
+      parameters.knots[0].parameters[0].x->paramID,
+      parameters.knots[0].parameters[1].x->paramID,
+      false)
+  , y(apvts,
+      yLabel,
+      parameters.knots[0].linked.getID(),
+      parameters.knots[0].parameters[0].y->paramID,
+      parameters.knots[0].parameters[1].y->paramID,
+      false)
+  , t(apvts,
+      "Tangent",
+      parameters.knots[0].linked.getID(),
+      parameters.knots[0].parameters[0].t->paramID,
+      parameters.knots[0].parameters[1].t->paramID,
+      false)
+  , s(apvts,
+      "Smoothness",
+      parameters.knots[0].linked.getID(),
+      parameters.knots[0].parameters[0].s->paramID,
+      parameters.knots[0].parameters[1].s->paramID,
+      false)
 {
   enabled.getControl().setButtonText("Knot is Active");
   linked.getControl().setButtonText("Knot is Linked");
@@ -663,6 +755,10 @@ SplineKnotEditor::SplineKnotEditor(SplineParameters& parameters,
   addAndMakeVisible(label);
   addAndMakeVisible(channelLabels);
   addAndMakeVisible(selectedKnot);
+  addAndMakeVisible(x);
+  addAndMakeVisible(y);
+  addAndMakeVisible(t);
+  addAndMakeVisible(s);
 
   for (int i = 1; i <= parameters.knots.size(); ++i) {
     selectedKnot.addItem(std::to_string(i), i);
@@ -682,8 +778,6 @@ SplineKnotEditor::SplineKnotEditor(SplineParameters& parameters,
   setSize(360, 120);
 
   setKnot(0);
-
-  startTimer(50);
 }
 
 void
@@ -721,23 +815,19 @@ SplineKnotEditor::resized()
 
   resize(channelLabels, (int)(50 * widthFactor));
 
-  if (!x || !y || !s || !t) {
-    return;
-  }
-
   int const width =
     (int)std::floor(((float)getWidth() - 50 * widthFactor + 4.f) / 4.f);
 
-  resize(*x, width);
-  resize(*y, width);
-  resize(*t, width);
-  resize(*s, width);
+  resize(x, width);
+  resize(y, width);
+  resize(t, width);
+  resize(s, width);
 }
 
 void
 SplineKnotEditor::paint(Graphics& g)
 {
-  int right = s->getBounds().getRight();
+  int right = s.getBounds().getRight();
   g.setColour(tableSettings.backgroundColour);
   g.fillRect(0, 0, right, getHeight() / 4);
 
@@ -757,10 +847,10 @@ SplineKnotEditor::setTableSettings(LinkableControlTable settings)
 {
   tableSettings = settings;
   channelLabels.tableSettings = settings;
-  x->tableSettings = settings;
-  y->tableSettings = settings;
-  t->tableSettings = settings;
-  s->tableSettings = settings;
+  x.tableSettings = settings;
+  y.tableSettings = settings;
+  t.tableSettings = settings;
+  s.tableSettings = settings;
 }
 
 void
@@ -780,76 +870,35 @@ SplineKnotEditor::setKnot(int newKnotIndex, bool forceUpdate)
   linked.setParameter(linkedParamID);
   enabled.setParameter(enabledParamID);
 
-  if (x) {
-    removeChildComponent(x.get());
-  }
-
-  x = std::make_unique<LinkableControl<AttachedSlider>>(
-    apvts,
-    xLabel,
-    linkedParamID,
-    knot.parameters[0].x->paramID,
-    knot.parameters[1].x->paramID,
-    false);
+  // the controls are rebound to the parameters of the knot, not recreated
 
-  addAndMakeVisible(*x);
+  using KnotParameters = SplineParameters::KnotParameters;
 
-  if (y) {
-    removeChildComponent(y.get());
-  }
-
-  y = std::make_unique<LinkableControl<AttachedSlider>>(
-    apvts,
-    yLabel,
-    linkedParamID,
-    knot.parameters[0].y->paramID,
-    knot.parameters[1].y->paramID,
-    false);
-
-  addAndMakeVisible(*y);
-
-  if (t) {
-    removeChildComponent(t.get());
-  }
-
-  t = std::make_unique<LinkableControl<AttachedSlider>>(
-    apvts,
-    "Tangent",
-    linkedParamID,
-    knot.parameters[0].t->paramID,
-    knot.parameters[1].t->paramID,
-    false);
-
-  addAndMakeVisible(*t);
-
-  if (s) {
-    removeChildComponent(s.get());
-  }
+  auto const bind = [&](LinkableControl<AttachedSlider>& control,
+                        AudioParameterFloat* KnotParameters::*parameter) {
+    control.setParameters(linkedParamID,
+                          (knot.parameters[0].*parameter)->paramID,
+                          (knot.parameters[1].*parameter)->paramID);
+  };
 
-  s = std::make_unique<LinkableControl<AttachedSlider>>(
-    apvts,
-    "Smoothness",
-    linkedParamID,
-    knot.parameters[0].s->paramID,
-    knot.parameters[1].s->paramID,
-    false);
+  bind(x, &KnotParameters::x);
+  bind(y, &KnotParameters::y);
+  bind(t, &KnotParameters::t);
+  bind(s, &KnotParameters::s);
 
-  addAndMakeVisible(*s);
+  x.getLabel().setText(xLabel, dontSendNotification);
+  y.getLabel().setText(yLabel, dontSendNotification);
 
   if (splineEditor) {
     for (int c = 0; c < 2; ++c) {
-      x->getControl(c).setTextValueSuffix(splineEditor->xSuffix);
-      y->getControl(c).setTextValueSuffix(splineEditor->ySuffix);
+      x.getControl(c).setTextValueSuffix(splineEditor->xSuffix);
+      y.getControl(c).setTextValueSuffix(splineEditor->ySuffix);
       if (splineEditor->ySuffix != splineEditor->xSuffix) {
-        t->getControl(c).setTextValueSuffix(splineEditor->ySuffix + "/" +
-                                            splineEditor->xSuffix);
+        t.getControl(c).setTextValueSuffix(splineEditor->ySuffix + "/" +
+                                           splineEditor->xSuffix);
       }
     }
   }
-
-  setTableSettings(tableSettings);
-
-  resized();
 }
 
 void
@@ -18,6 +18,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 #include "Attachments.h"
 #include "Linkables.h"
+#include "MeterBus.h"
 #include "SplineParameters.h"
 #include "adsp/Spline.hpp"
 #include <JuceHeader.h>
@@ -31,34 +32,95 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #define JUICY_MAX_SPLINE_EDITOR_NUM_KNOTS 17
 #endif
 
-struct SplineAttachments
+/**
+ * Attachments to all the parameters of a spline. The changes of all of them
+ * are collected, and delivered with a single call to the onChange functor per
+ * message loop iteration, with bitmasks of the knots that changed.
+ */
+struct SplineAttachments : private AsyncUpdater
 {
+  static constexpr int maxNumKnots = 64;
+
+  struct Change
+  {
+    // bit k is set if the x, y, tangent or smoothness of knot k changed
+    uint64_t knotValues = 0;
+    // bit k is set if knot k was enabled, disabled, linked or unlinked
+    uint64_t knotStates = 0;
+    bool symmetry = false;
+
+    bool isKnotChanged(int knot) const
+    {
+      return ((knotValues | knotStates) >> knot) & 1;
+    }
+  };
+
+  struct KnotValueCallback
+  {
+    SplineAttachments* attachments;
+    int knot;
+    void operator()() const { attachments->onKnotValueChange(knot); }
+  };
+
+  struct KnotStateCallback
+  {
+    SplineAttachments* attachments;
+    int knot;
+    void operator()() const { attachments->onKnotStateChange(knot); }
+  };
+
+  struct SymmetryCallback
+  {
+    SplineAttachments* attachments;
+    void operator()() const { attachments->onSymmetryChange(); }
+  };
+
+  using KnotValueAttachment = TypedFloatAttachment<KnotValueCallback>;
+  using KnotStateAttachment = TypedBoolAttachment<KnotStateCallback>;
+  using SymmetryAttachment = TypedBoolAttachment<SymmetryCallback>;
+
   struct KnotAttachments
   {
-    std::unique_ptr<FloatAttachment> x;
-    std::unique_ptr<FloatAttachment> y;
-    std::unique_ptr<FloatAttachment> t;
-    std::unique_ptr<FloatAttachment> s;
+    std::unique_ptr<KnotValueAttachment> x;
+    std::unique_ptr<KnotValueAttachment> y;
+    std::unique_ptr<KnotValueAttachment> t;
+    std::unique_ptr<KnotValueAttachment> s;
   };
 
   struct LinkableKnotAttachments
   {
     std::array<KnotAttachments, 2> parameters;
-    std::unique_ptr<BoolAttachment> enabled;
-    std::unique_ptr<BoolAttachment> linked;
+    std::unique_ptr<KnotStateAttachment> enabled;
+    std::unique_ptr<KnotStateAttachment> linked;
   };
 
   std::vector<LinkableKnotAttachments> knots;
 
-  std::array<std::unique_ptr<BoolAttachment>, 2> symmetry;
+  std::array<std::unique_ptr<SymmetryAttachment>, 2> symmetry;
 
   SplineAttachments(
     SplineParameters& parameters,
     AudioProcessorValueTreeState& apvts,
-    std::function<void(void)> onChange,
+    std::function<void(Change const&)> onChange,
     LinkableParameter<WrappedBoolParameter>* symmetryParameter = nullptr);
 
+  ~SplineAttachments() override { cancelPendingUpdate(); }
+
   int getNumActiveKnots();
+
+  uint64_t getEnabledKnots();
+
+private:
+  void onKnotValueChange(int knot);
+  void onKnotStateChange(int knot);
+  void onSymmetryChange();
+
+  void handleAsyncUpdate() override;
+
+  std::function<void(Change const&)> onChange;
+
+  // the attachments call back on the message thread only
+  Change pendingChange;
 };
 
 class SplineEditor;
@@ -114,7 +176,10 @@ public:
 
   Point<int> numGridLines = { 8, 8 };
 
-  std::array<std::atomic<float>*, 2> vuMeter = { { nullptr, nullptr } };
+  // if set, the values at vuMeterBusIndices are shown as input levels
+  MeterBus* vuMeterBus = nullptr;
+
+  std::array<int, 2> vuMeterBusIndices = { { 0, 1 } };
 
   Colour backgroundColour = Colours::black;
 
@@ -173,7 +238,9 @@ private:
 
   VecBuffer<Vec2d> vuMeterBuffer{ 1 };
 
-  void onSplineChange();
+  MeterBus::Snapshot vuMeterSnapshot;
+
+  void onSplineChange(SplineAttachments::Change const& change);
 
   int selectedKnot = 0;
 
@@ -218,9 +285,7 @@ private:
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SplineEditor)
 };
 
-class SplineKnotEditor
-  : public Component
-  , public Timer
+class SplineKnotEditor : public Component
 {
   friend void attachAndInitializeSplineEditors(SplineEditor& splineEditor,
                                                SplineKnotEditor& knotEditor,
@@ -245,8 +310,6 @@ public:
 private:
   void setKnot(int newKnotIndex, bool forceUpdate = false);
 
-  void timerCallback() override { repaint(); }
-
   SplineEditor* splineEditor = nullptr;
 
   int knotIndex = -1;
@@ -263,10 +326,11 @@ private:
 
   ChannelLabels channelLabels;
 
-  std::unique_ptr<LinkableControl<AttachedSlider>> x;
-  std::unique_ptr<LinkableControl<AttachedSlider>> y;
-  std::unique_ptr<LinkableControl<AttachedSlider>> t;
-  std::unique_ptr<LinkableControl<AttachedSlider>> s;
+  // bound to the parameters of the selected knot by setKnot
+  LinkableControl<AttachedSlider> x;
+  LinkableControl<AttachedSlider> y;
+  LinkableControl<AttachedSlider> t;
+  LinkableControl<AttachedSlider> s;
 
   LinkableControlTable tableSettings;
 
@@ -18,21 +18,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "SplineParameters.h"
 #include <cassert>
 
-bool
-SplineParameters::LinkableKnotParameters::needsReset()
-{
-  bool const isEnabled = IsEnabled();
-  bool const isLinked = IsLinked();
-  bool const resetFlag = (wasEnabled != isEnabled) || (wasLinked != isLinked);
-  wasEnabled = isEnabled;
-  wasLinked = isLinked;
-  return resetFlag;
-}
-
 SplineParameters::KnotParameters&
 SplineParameters::LinkableKnotParameters::getActiveParameters(int channel)
 {
-  if (IsLinked()) {
+  if (linked.getValue()) {
     return parameters[0];
   }
   return parameters[channel];
@@ -41,24 +30,61 @@ SplineParameters::LinkableKnotParameters::getActiveParameters(int channel)
 int
 SplineParameters::getNumActiveKnots()
 {
-  int numKnots = (int)fixedKnots.size();
-  for (auto& knot : knots) {
-    if (knot.IsEnabled()) {
-      ++numKnots;
-    }
-  }
-  return numKnots;
+  return (int)fixedKnots.size() + bitMask::countSetBits(getEnabledKnots());
 }
 
 bool
 SplineParameters::needsReset()
 {
-  for (auto& knot : knots) {
-    if (knot.needsReset()) {
-      return true;
+  uint64_t const enabled = getEnabledKnots();
+  uint64_t const linked = getLinkedKnots();
+  bool const resetFlag = ((enabled ^ previousEnabledKnots) |
+                          (linked ^ previousLinkedKnots)) != 0;
+  previousEnabledKnots = enabled;
+  previousLinkedKnots = linked;
+  return resetFlag;
+}
+
+uint64_t
+SplineParameters::getChangedKnots(
+  ParameterChangeSet::Changes const& changes)
+{
+  if (knots.empty() || changes.isEmpty()) {
+    return 0;
+  }
+  auto& first = knots.front();
+  int const firstIndex =
+    jmin(first.enabled.getParameter()->getParameterIndex(),
+         first.parameters[0].x->getParameterIndex());
+  int const numKnots = jmin(64, (int)knots.size());
+  jassert(knots[numKnots - 1].linked.getParameter()->getParameterIndex() <
+          firstIndex + numKnots * numParametersPerKnot);
+
+  uint64_t changedKnots = 0;
+  changes.forEach([&](int parameterIndex) {
+    int const offset = parameterIndex - firstIndex;
+    if (offset >= 0 && offset < numKnots * numParametersPerKnot) {
+      changedKnots |= bitMask::bit(offset / numParametersPerKnot);
+    }
+  });
+  return changedKnots;
+}
+
+void
+SplineParameters::listenToKnotStates()
+{
+  jassert(knots.size() <= 64);
+  int const numKnots = jmin(64, (int)knots.size());
+  knotStateListeners.reserve(2 * numKnots);
+  for (int k = 0; k < numKnots; ++k) {
+    auto& knot = knots[k];
+    for (auto [flag, mask] : { std::make_pair(&knot.enabled, &enabledKnots),
+                               std::make_pair(&knot.linked, &linkedKnots) }) {
+      knotStateListeners.push_back(
+        std::make_unique<KnotStateListener>(*flag, *mask, k));
     }
   }
-  return false;
+  // as the knots were disabled and unlinked before, the first block resets
 }
 
 SplineParameters::SplineParameters(
@@ -137,6 +163,14 @@ SplineParameters::SplineParameters(
   for (int i = 0; i < numKnots; ++i) {
     knots.push_back(createLinkableKnotParameters(i));
   }
+
+  listenToKnotStates();
+}
+
+SplineParameters::~SplineParameters()
+{
+  // each listener removes itself from its parameter
+  knotStateListeners.clear();
 }
 
 SplineParameters::SplineParameters(std::vector<AudioParameterFloat*> parameters,
@@ -166,4 +200,6 @@ SplineParameters::SplineParameters(std::vector<AudioParameterFloat*> parameters,
                              WrappedBoolParameter(parameters[p + 9])));
     p += 10;
   }
+
+  listenToKnotStates();
 }
@@ -16,15 +16,26 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #pragma once
+#include "BitMask.h"
 #include "Linkables.h"
+#include "ParameterChangeSet.h"
 #include "adsp/Spline.hpp"
 #include <JuceHeader.h>
 #include <array>
+#include <atomic>
 #include <functional>
+#include <memory>
 
 /**
  * Linkable parameters for the splines in
  * https://github.com/unevens/audio-dsp/blob/master/adsp/Spline.hpp
+ * The enabled and linked flags of the knots are also kept in two bitmasks,
+ * updated by listeners to their parameters, so that the audio thread can count
+ * and iterate the enabled knots, and detect when they change, with a few bit
+ * operations instead of reading every flag every block. At most 64 knots are
+ * supported.
+ * The parameters are owned by the AudioProcessor, which destroys them after the
+ * members of its subclasses, so the listeners are removed by the destructor.
  */
 
 struct SplineParameters
@@ -47,9 +58,6 @@ struct SplineParameters
 
   class LinkableKnotParameters
   {
-    bool wasLinked = false;
-    bool wasEnabled = false;
-
   public:
     std::array<KnotParameters, 2> parameters;
     WrappedBoolParameter enabled;
@@ -64,17 +72,24 @@ struct SplineParameters
       , linked{ linked }
     {}
 
-    bool IsEnabled() { return enabled.getValue(); };
-    bool IsLinked() { return linked.getValue(); };
-
-    bool needsReset();
-
     KnotParameters& getActiveParameters(int channel);
   };
 
   std::vector<LinkableKnotParameters> knots;
   std::vector<KnotData> fixedKnots;
 
+  // bit k is set if knot k is enabled
+  uint64_t getEnabledKnots() const
+  {
+    return enabledKnots.load(std::memory_order_acquire);
+  }
+
+  // bit k is set if the channels of knot k are linked
+  uint64_t getLinkedKnots() const
+  {
+    return linkedKnots.load(std::memory_order_acquire);
+  }
+
   NormalisableRange<float> rangeX;
   NormalisableRange<float> rangeY;
   NormalisableRange<float> rangeTan;
@@ -100,6 +115,8 @@ struct SplineParameters
                    NormalisableRange<float> rangeTan,
                    std::vector<KnotData> fixedKnots = {});
 
+  ~SplineParameters();
+
   template<class Vec, int maxNumKnots>
   int updateSpline(adsp::AutoSpline<Vec, maxNumKnots>& spline)
   {
@@ -116,18 +133,18 @@ struct SplineParameters
       ++n;
     }
 
-    for (auto& knot : knots) {
-      if (knot.IsEnabled()) {
-        for (int c = 0; c < 2; ++c) {
-          auto& params = knot.getActiveParameters(c);
-          automationKnots[n].x[c] = params.x->get();
-          automationKnots[n].y[c] = params.y->get();
-          automationKnots[n].t[c] = params.t->get();
-          automationKnots[n].s[c] = params.s->get();
-        }
-        ++n;
+    uint64_t const linked = getLinkedKnots();
+    bitMask::forEachSetBit(getEnabledKnots(), [&](int k) {
+      int const isLinked = (int)((linked >> k) & 1);
+      for (int c = 0; c < 2; ++c) {
+        auto& params = knots[k].parameters[isLinked ? 0 : c];
+        automationKnots[n].x[c] = params.x->get();
+        automationKnots[n].y[c] = params.y->get();
+        automationKnots[n].t[c] = params.t->get();
+        automationKnots[n].s[c] = params.s->get();
       }
-    }
+      ++n;
+    });
 
     if (needsReset()) {
       spline.reset();
@@ -151,19 +168,118 @@ struct SplineParameters
       ++n;
     }
 
-    for (auto& knot : knots) {
-      if (knot.IsEnabled()) {
-        for (int c = 0; c < 2; ++c) {
-          auto& params = knot.getActiveParameters(c);
-          splineKnots[n].x[c] = params.x->get();
-          splineKnots[n].y[c] = params.y->get();
-          splineKnots[n].t[c] = params.t->get();
-          splineKnots[n].s[c] = params.s->get();
-        }
-        ++n;
-      }
-    }
+    uint64_t const linked = getLinkedKnots();
+    bitMask::forEachSetBit(getEnabledKnots(), [&](int k) {
+      readKnot(splineKnots[n], k, linked);
+      ++n;
+    });
 
     return n;
   }
+
+  /**
+   * Same as updateSpline, but it reads only the knots whose parameters are in
+   * the changes collected from a ParameterChangeSet of the AudioProcessor. All
+   * the knots are read the first time, and when a knot is enabled, disabled,
+   * linked or unlinked, as that moves the following knots in the spline.
+   * The parameters of each knot must have consecutive indices in the
+   * AudioProcessor, as they have when created by this class. Only one spline
+   * can be kept up to date this way by each SplineParameters.
+   */
+  template<class Vec, int maxNumKnots>
+  int updateSpline(adsp::Spline<Vec, maxNumKnots>& spline,
+                   ParameterChangeSet::Changes const& changes)
+  {
+    uint64_t const enabled = getEnabledKnots();
+    uint64_t const linked = getLinkedKnots();
+    if (!isSplineTracked || enabled != trackedEnabledKnots ||
+        linked != trackedLinkedKnots) {
+      isSplineTracked = true;
+      trackedEnabledKnots = enabled;
+      trackedLinkedKnots = linked;
+      return updateSpline(spline);
+    }
+
+    auto& splineKnots = spline.settings.knots;
+    int const numFixedKnots = (int)fixedKnots.size();
+    bitMask::forEachSetBit(getChangedKnots(changes) & enabled, [&](int k) {
+      int const n = numFixedKnots +
+                    bitMask::countSetBits(enabled & (bitMask::bit(k) - 1));
+      readKnot(splineKnots[n], k, linked);
+    });
+
+    return numFixedKnots + bitMask::countSetBits(enabled);
+  }
+
+  /**
+   * Returns a mask with bit k set if any parameter of knot k is in the
+   * changes.
+   */
+  uint64_t getChangedKnots(ParameterChangeSet::Changes const& changes);
+
+private:
+  static constexpr int numParametersPerKnot = 10;
+
+  template<class Knot>
+  void readKnot(Knot& knot, int k, uint64_t linked)
+  {
+    int const isLinked = (int)((linked >> k) & 1);
+    for (int c = 0; c < 2; ++c) {
+      auto& params = knots[k].parameters[isLinked ? 0 : c];
+      knot.x[c] = params.x->get();
+      knot.y[c] = params.y->get();
+      knot.t[c] = params.t->get();
+      knot.s[c] = params.s->get();
+    }
+  }
+
+  class KnotStateListener : public AudioProcessorParameter::Listener
+  {
+  public:
+    KnotStateListener(WrappedBoolParameter flag,
+                      std::atomic<uint64_t>& mask,
+                      int knot)
+      : flag(flag)
+      , mask(mask)
+      , bit(bitMask::bit(knot))
+    {
+      auto* const parameter = flag.getParameter();
+      parameterValueChanged(parameter->getParameterIndex(),
+                            parameter->getValue());
+      parameter->addListener(this);
+    }
+
+    ~KnotStateListener() override { flag.getParameter()->removeListener(this); }
+
+    // the same truth test as WrappedBoolParameter::getValue
+    void parameterValueChanged(int, float newValue) override
+    {
+      if (flag.isTrue(newValue)) {
+        mask.fetch_or(bit, std::memory_order_acq_rel);
+      }
+      else {
+        mask.fetch_and(~bit, std::memory_order_acq_rel);
+      }
+    }
+
+    void parameterGestureChanged(int, bool) override {}
+
+  private:
+    WrappedBoolParameter flag;
+    std::atomic<uint64_t>& mask;
+    uint64_t const bit;
+  };
+
+  void listenToKnotStates();
+
+  std::atomic<uint64_t> enabledKnots{ 0 };
+  std::atomic<uint64_t> linkedKnots{ 0 };
+  // the masks seen by the last call to needsReset, used by the audio thread
+  uint64_t previousEnabledKnots = 0;
+  uint64_t previousLinkedKnots = 0;
+  // the masks of the spline kept up to date with the changes, audio thread only
+  bool isSplineTracked = false;
+  uint64_t trackedEnabledKnots = 0;
+  uint64_t trackedLinkedKnots = 0;
+  std::vector<std::unique_ptr<KnotStateListener>> knotStateListeners;
 };
@@ -16,6 +16,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #pragma once
+#include "ParameterHandle.h"
 #include <JuceHeader.h>
 
 /**
@@ -23,16 +24,25 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
  * AudioParameterFloat as it was a AudioParameterBool. Its use case scenario is
  * when you only use float parameters as a way to communicate with the host, and
  * dynamically change their meaning.
+ * Both kinds of parameters are held as a RangedAudioParameter, together with
+ * the threshold of their truth test, see isBoolParameterValueTrue, so no
+ * branch on the kind of parameter is needed.
+ * Code that reads the value every block should use the BoolParameterHandle
+ * returned by getHandle, which reads the raw value with no virtual calls, and
+ * applies the same truth test.
  */
 
 class WrappedBoolParameter
 {
-  AudioParameterBool* boolParameter;
-  AudioParameterFloat* floatParameter;
+  RangedAudioParameter* parameter;
+  float threshold;
 
 public:
   bool getValue();
 
+  // the truth test of getValue, applied to a normalised value
+  bool isTrue(float normalisedValue) const;
+
   String const& getID();
 
   std::unique_ptr<RangedAudioParameter> createParameter(String const& name,
@@ -41,30 +51,34 @@ public:
 
   RangedAudioParameter* getParameter();
 
+  BoolParameterHandle getHandle(AudioProcessorValueTreeState& apvts);
+
   WrappedBoolParameter(AudioParameterFloat* floatParameter = nullptr,
                        AudioParameterBool* boolParameter = nullptr)
-    : floatParameter(floatParameter)
-    , boolParameter(boolParameter)
-
+    : parameter(floatParameter
+                  ? static_cast<RangedAudioParameter*>(floatParameter)
+                  : static_cast<RangedAudioParameter*>(boolParameter))
+    , threshold(parameter ? getBoolParameterThreshold(parameter) : 0.f)
   {}
 };
 
 inline bool
 WrappedBoolParameter::getValue()
 {
-  if (boolParameter) {
-    return boolParameter->get();
-  }
-  return floatParameter->get();
+  return isTrue(parameter->getValue());
+}
+
+inline bool
+WrappedBoolParameter::isTrue(float normalisedValue) const
+{
+  return isBoolParameterValueTrue(parameter->convertFrom0to1(normalisedValue),
+                                  threshold);
 }
 
 inline String const&
 WrappedBoolParameter::getID()
 {
-  if (boolParameter) {
-    return boolParameter->paramID;
-  }
-  return floatParameter->paramID;
+  return parameter->paramID;
 }
 
 inline std::unique_ptr<RangedAudioParameter>
@@ -73,25 +87,24 @@ WrappedBoolParameter::createParameter(String const& name,
                                       bool useFloat)
 {
   if (useFloat) {
-    boolParameter = new AudioParameterBool(name, name, value);
-    floatParameter = nullptr;
-    return std::unique_ptr<RangedAudioParameter>(boolParameter);
+    parameter = new AudioParameterBool(name, name, value);
   }
   else {
-    boolParameter = nullptr;
-    floatParameter = new AudioParameterFloat(
+    parameter = new AudioParameterFloat(
       name, name, { 0.0f, 1.f, 1.0f }, value ? 1.f : 0.f);
-    return std::unique_ptr<RangedAudioParameter>(floatParameter);
   }
+  threshold = getBoolParameterThreshold(parameter);
+  return std::unique_ptr<RangedAudioParameter>(parameter);
 }
 
 inline RangedAudioParameter*
 WrappedBoolParameter::getParameter()
 {
-  auto p = static_cast<RangedAudioParameter*>(floatParameter);
-  if (p) {
-    return p;
-  }
-  p = static_cast<RangedAudioParameter*>(boolParameter);
-  return p;
+  return parameter;
+}
+
+inline BoolParameterHandle
+WrappedBoolParameter::getHandle(AudioProcessorValueTreeState& apvts)
+{
+  return makeParameterHandle<bool>(apvts, parameter->paramID);
 }